@@ -0,0 +1,388 @@
+/*
+ * bench/cheatnote_bench.c
+ *
+ * End-to-end timings of the core operations on synthetic databases.
+ * Links every library object except main.o and drives the same entry
+ * points the CLI uses (cn_db_*, cn_cmd_*).
+ *
+ * Usage: cheatnote_bench [-r rounds] [-d dir] [notes...]
+ *        (default sizes: 10000 100000)
+ *
+ * For each size a database is generated in a scratch directory with a
+ * skewed size distribution (half the notes around a hundred bytes, a long
+ * tail up to the content limit), then timed:
+ *   generate, save, load, open-ro, list-<mode>..., index-build, export, import,
+ *   export-bin, import-bin
+ *
+ * Output is one line per measurement, whitespace separated:
+ *   db <op> <notes> <seconds> <notes_per_sec>
+ * Lines starting with '#' are comments. Timed values are the best of
+ * `rounds` runs except generate/index-build/import(-bin), which run once.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "cheatnote.h"
+#include "db.h"
+#include "notes_io.h"
+#include "commands.h"
+
+/* The library expects these from main.c */
+cn_note_db db = {0};
+int use_colors = 0;
+char db_path[PATH_MAX] = "";
+
+static const char *WORDS[] = {
+    "git", "status", "push", "pull", "rebase", "docker", "compose", "run",
+    "kubectl", "apply", "logs", "grep", "sed", "awk", "tar", "xzf", "ssh",
+    "config", "make", "install", "return", "while", "struct", "printf",
+    "python", "venv", "pip", "npm", "systemctl", "restart", "journalctl",
+    "--force", "-rf", "origin/main", "HEAD~1", "echo", "$PATH", "|", "&&",
+    "curl", "-sSL", "jq", ".items[]", "find", "-name", "xargs", "chmod",
+};
+static const char *TAGS[] = {
+    "git", "docker", "linux", "k8s", "shell", "python", "net", "db",
+    "vim", "ssh", "build", "ci", "aws", "js", "rust", "go",
+};
+#define NWORDS (sizeof(WORDS) / sizeof(WORDS[0]))
+#define NTAGS (sizeof(TAGS) / sizeof(TAGS[0]))
+
+static unsigned long long rng_state = 0x2545F4914F6CDD1Dull;
+
+static unsigned rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned)(rng_state >> 32);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Fill buf with words up to about `len` bytes (always < cap) */
+static void fill_words(char *buf, size_t cap, size_t len)
+{
+    size_t pos = 0;
+    if (len >= cap)
+        len = cap - 1;
+    while (pos < len)
+    {
+        const char *w = WORDS[rng() % NWORDS];
+        size_t wl = strlen(w);
+        if (pos + wl + 1 >= cap)
+            break;
+        if (pos)
+            buf[pos++] = ' ';
+        memcpy(buf + pos, w, wl);
+        pos += wl;
+    }
+    buf[pos] = '\0';
+}
+
+/* Content length: geometric over power-of-two bands, so half the notes are
+ * under ~110 bytes and a few approach MAX_CONTENT_LEN. */
+static size_t content_length(void)
+{
+    unsigned k = 0;
+    while (k < 7 && (rng() & 1))
+        ++k;
+    return 48 + rng() % (64u << k);
+}
+
+static void generate(size_t count)
+{
+    static char title[MAX_TITLE_LEN], content[MAX_CONTENT_LEN], tags[MAX_TAGS_LEN];
+
+    cn_db_cleanup();
+    cn_db_init();
+    for (size_t i = 0; i < count; ++i)
+    {
+        fill_words(title, sizeof(title), 12 + rng() % 48);
+        fill_words(content, sizeof(content), content_length());
+
+        size_t ntags = rng() % 4, pos = 0;
+        tags[0] = '\0';
+        for (size_t t = 0; t < ntags; ++t)
+            pos += (size_t)snprintf(tags + pos, sizeof(tags) - pos, "%s%s", t ? "," : "",
+                                    TAGS[rng() % NTAGS]);
+
+        if (cn_note_add(title, content, tags) == 0)
+        {
+            fprintf(stderr, "generate: cn_note_add failed at %zu\n", i);
+            exit(1);
+        }
+    }
+}
+
+/* Silence command output while timing */
+static int saved_stdout = -1;
+
+static void mute(void)
+{
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd >= 0)
+    {
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+}
+
+static void unmute(void)
+{
+    fflush(stdout);
+    if (saved_stdout >= 0)
+    {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        saved_stdout = -1;
+    }
+}
+
+static void report(const char *op, size_t count, double secs)
+{
+    printf("db %s %zu %.6f %.0f\n", op, count, secs, secs > 0 ? (double)count / secs : 0.0);
+    fflush(stdout);
+}
+
+static int run_cmd(int (*cmd)(int, char **), const char *const *args)
+{
+    char *argv[16];
+    int argc = 0;
+    while (args[argc] && argc < 15)
+    {
+        argv[argc] = (char *)args[argc];
+        ++argc;
+    }
+    argv[argc] = NULL;
+    return cmd(argc, argv);
+}
+
+typedef struct
+{
+    const char *name;
+    const char *args[8];
+} list_mode;
+
+static const list_mode LIST_MODES[] = {
+    {"list-all", {"list", "-c", NULL}},
+    {"list-substr", {"list", "-c", "-s", "docker", NULL}},
+    {"list-icase", {"list", "-c", "-i", "-s", "DOCKER", NULL}},
+    {"list-exact", {"list", "-c", "-e", "-s", "git status", NULL}},
+    {"list-regex", {"list", "-c", "-r", "-s", "git (push|pull)", NULL}},
+    {"list-regex-icase", {"list", "-c", "-r", "-i", "-s", "GIT (PUSH|PULL)", NULL}},
+    {"list-regex-nested", {"list", "-c", "-r", "-s", "(e|ee)*x+\\b", NULL}},
+    {"list-word", {"list", "-c", "-r", "-w", "-s", "kubectl", NULL}},
+    {"list-tags", {"list", "-c", "-g", "linux", NULL}},
+    {"list-miss", {"list", "-c", "-s", "zzqx", NULL}},
+};
+
+static void bench_size(const char *dir, size_t count, int rounds)
+{
+    char path[PATH_MAX], idx[PATH_MAX + 8], csv[PATH_MAX], snap[PATH_MAX], imported[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/bench-%zu.db", dir, count);
+    snprintf(idx, sizeof(idx), "%s.idx", path);
+    snprintf(csv, sizeof(csv), "%s/bench-%zu.csv", dir, count);
+    snprintf(snap, sizeof(snap), "%s/bench-%zu.cnb", dir, count);
+    snprintf(imported, sizeof(imported), "%s/bench-%zu-import.db", dir, count);
+    cn_set_db_path(path);
+
+    double t0 = now_sec();
+    generate(count);
+    report("generate", count, now_sec() - t0);
+
+    double best = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        t0 = now_sec();
+        cn_db_save();
+        double t = now_sec() - t0;
+        if (r == 0 || t < best)
+            best = t;
+    }
+    report("save", count, best);
+
+    for (int r = 0; r < rounds; ++r)
+    {
+        cn_db_cleanup();
+        t0 = now_sec();
+        cn_db_load();
+        double t = now_sec() - t0;
+        if (r == 0 || t < best)
+            best = t;
+    }
+    report("load", count, best);
+
+    for (int r = 0; r < rounds; ++r)
+    {
+        cn_db_cleanup();
+        t0 = now_sec();
+        cn_db_open_readonly();
+        double t = now_sec() - t0;
+        if (r == 0 || t < best)
+            best = t;
+    }
+    report("open-ro", count, best);
+
+    /* Cold substring search: builds and writes the inverted index */
+    unlink(idx);
+    mute();
+    t0 = now_sec();
+    run_cmd(cn_cmd_list, LIST_MODES[1].args);
+    double cold = now_sec() - t0;
+    unmute();
+    report("index-build", count, cold);
+
+    for (size_t m = 0; m < sizeof(LIST_MODES) / sizeof(LIST_MODES[0]); ++m)
+    {
+        for (int r = 0; r < rounds; ++r)
+        {
+            mute();
+            t0 = now_sec();
+            run_cmd(cn_cmd_list, LIST_MODES[m].args);
+            double t = now_sec() - t0;
+            unmute();
+            if (r == 0 || t < best)
+                best = t;
+        }
+        report(LIST_MODES[m].name, count, best);
+    }
+
+    const char *export_args[] = {"export", csv, NULL};
+    for (int r = 0; r < rounds; ++r)
+    {
+        mute();
+        t0 = now_sec();
+        run_cmd(cn_cmd_export, export_args);
+        double t = now_sec() - t0;
+        unmute();
+        if (r == 0 || t < best)
+            best = t;
+    }
+    report("export", count, best);
+
+    const char *snap_args[] = {"export", snap, NULL};
+    for (int r = 0; r < rounds; ++r)
+    {
+        mute();
+        t0 = now_sec();
+        run_cmd(cn_cmd_export, snap_args);
+        double t = now_sec() - t0;
+        unmute();
+        if (r == 0 || t < best)
+            best = t;
+    }
+    report("export-bin", count, best);
+
+    /* Import (replace) into a fresh database, including its save */
+    cn_db_cleanup();
+    cn_set_db_path(imported);
+    cn_db_load();
+    const char *import_args[] = {"import", csv, NULL};
+    mute();
+    t0 = now_sec();
+    run_cmd(cn_cmd_import, import_args);
+    double t = now_sec() - t0;
+    unmute();
+    report("import", count, t);
+
+    cn_db_cleanup();
+    cn_db_load();
+    const char *restore_args[] = {"import", snap, NULL};
+    mute();
+    t0 = now_sec();
+    run_cmd(cn_cmd_import, restore_args);
+    t = now_sec() - t0;
+    unmute();
+    report("import-bin", count, t);
+
+    cn_db_cleanup();
+    const char *suffixes[] = {"", ".wal", ".idx", ".lock"};
+    char victim[PATH_MAX + 8];
+    for (size_t s = 0; s < sizeof(suffixes) / sizeof(suffixes[0]); ++s)
+    {
+        snprintf(victim, sizeof(victim), "%s%s", path, suffixes[s]);
+        unlink(victim);
+        snprintf(victim, sizeof(victim), "%s%s", imported, suffixes[s]);
+        unlink(victim);
+    }
+    unlink(csv);
+    unlink(snap);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = 3;
+    const char *dir = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:d:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-r rounds] [-d dir] [notes...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (rounds <= 0)
+        rounds = 1;
+
+    char tmpl[] = "/tmp/cheatnote-bench-XXXXXX";
+    int own_dir = 0;
+    if (!dir)
+    {
+        dir = mkdtemp(tmpl);
+        if (!dir)
+        {
+            perror("mkdtemp");
+            return 1;
+        }
+        own_dir = 1;
+    }
+
+    static const size_t defaults[] = {10000, 100000};
+    printf("# db <op> <notes> <seconds> <notes_per_sec>\n");
+    if (optind < argc)
+    {
+        for (int i = optind; i < argc; ++i)
+        {
+            size_t n = strtoul(argv[i], NULL, 10);
+            if (n == 0 || n > MAX_NOTES)
+            {
+                fprintf(stderr, "invalid size: %s\n", argv[i]);
+                return 2;
+            }
+            bench_size(dir, n, rounds);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); ++i)
+            bench_size(dir, defaults[i], rounds);
+    }
+
+    if (own_dir)
+        rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * bench/strsearch_bench.c
+ *
+ * Throughput of the substring kernels in src/strsearch.c over a synthetic
+ * corpus of note-like text, compared against libc strstr/memmem.
+ *
+ * Usage: strsearch_bench [corpus_MiB] [rounds]
+ *
+ * Output is one line per (mode, kernel) pair:
+ *   strsearch <mode> <kernel> <GB/s>
+ * so results can be collected with grep/awk. Before timing, every kernel is
+ * cross-checked against the scalar one on random inputs; a mismatch fails
+ * with exit code 1.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "strsearch.h"
+
+static const char *WORDS[] = {
+    "git", "rebase", "docker", "compose", "kubectl", "apply", "grep", "sed",
+    "awk", "Tar", "ssh", "KEY", "config", "Makefile", "include", "return",
+    "while", "for", "struct", "printf", "Python", "venv", "pip", "install",
+    "-rf", "--force", "origin/main", "HEAD~1", "echo", "$PATH", "\n", "#",
+};
+
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ull;
+
+static unsigned rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned)(rng_state >> 32);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char *make_corpus(size_t len)
+{
+    char *buf = malloc(len + 1);
+    if (!buf)
+        return NULL;
+    size_t pos = 0;
+    while (pos < len)
+    {
+        const char *w = WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+        size_t wl = strlen(w);
+        if (wl > len - pos)
+            wl = len - pos;
+        memcpy(buf + pos, w, wl);
+        pos += wl;
+        if (pos < len)
+            buf[pos++] = ' ';
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+/* Compare every kernel against the scalar one on short random strings over
+ * a tiny alphabet, where matches and near-matches are frequent. */
+static int cross_check(void)
+{
+    static const char alpha[] = "abAB-c";
+    char hay[200], needle[12];
+    for (int iter = 0; iter < 200000; ++iter)
+    {
+        size_t hl = rng() % sizeof(hay);
+        size_t nl = 1 + rng() % (sizeof(needle) - 1);
+        for (size_t i = 0; i < hl; ++i)
+            hay[i] = alpha[rng() % (sizeof(alpha) - 1)];
+        for (size_t i = 0; i < nl; ++i)
+            needle[i] = alpha[rng() % (sizeof(alpha) - 1)];
+        int icase = (int)(rng() & 1);
+
+        cn_finder f;
+        if (!cn_finder_init(&f, needle, nl, icase))
+            return 0;
+        cn_finder_set_kernel(&f, CN_KERNEL_SCALAR);
+        const char *want = cn_finder_find(&f, hay, hl);
+        for (int k = CN_KERNEL_SSE2; k <= CN_KERNEL_AVX2; ++k)
+        {
+            if (cn_finder_set_kernel(&f, k) && cn_finder_find(&f, hay, hl) != want)
+            {
+                fprintf(stderr, "mismatch: kernel=%s icase=%d hay=%.*s needle=%.*s\n",
+                        cn_finder_kernel_name(&f), icase, (int)hl, hay, (int)nl, needle);
+                cn_finder_free(&f);
+                return 0;
+            }
+        }
+        cn_finder_free(&f);
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    size_t mib = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if (mib == 0 || rounds <= 0)
+    {
+        fprintf(stderr, "usage: %s [corpus_MiB] [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    if (!cross_check())
+        return 1;
+
+    size_t len = mib << 20;
+    char *corpus = make_corpus(len);
+    if (!corpus)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* Absent needle built from common letters: the whole corpus is scanned
+     * and first/last byte candidates are frequent. */
+    const char *needle = "grepx";
+    static const struct
+    {
+        const char *name;
+        int icase;
+    } modes[] = {{"case", 0}, {"icase", 1}};
+
+    for (size_t mi = 0; mi < sizeof(modes) / sizeof(modes[0]); ++mi)
+    {
+        for (int k = CN_KERNEL_SCALAR; k <= CN_KERNEL_AVX2; ++k)
+        {
+            cn_finder f;
+            if (!cn_finder_init(&f, needle, strlen(needle), modes[mi].icase))
+                return 1;
+            if (!cn_finder_set_kernel(&f, k))
+            {
+                cn_finder_free(&f);
+                continue;
+            }
+            double best = 0;
+            for (int r = 0; r < rounds; ++r)
+            {
+                double t0 = now_sec();
+                const char *volatile hit = cn_finder_find(&f, corpus, len);
+                double t = now_sec() - t0;
+                (void)hit;
+                if (best == 0 || t < best)
+                    best = t;
+            }
+            printf("strsearch %s %s %.2f\n", modes[mi].name, cn_finder_kernel_name(&f),
+                   (double)len / best / 1e9);
+            cn_finder_free(&f);
+        }
+    }
+
+    /* libc references */
+    double best_strstr = 0, best_memmem = 0;
+    for (int r = 0; r < rounds; ++r)
+    {
+        double t0 = now_sec();
+        const char *volatile hit = strstr(corpus, needle);
+        double t = now_sec() - t0;
+        if (best_strstr == 0 || t < best_strstr)
+            best_strstr = t;
+
+        t0 = now_sec();
+        hit = memmem(corpus, len, needle, strlen(needle));
+        t = now_sec() - t0;
+        (void)hit;
+        if (best_memmem == 0 || t < best_memmem)
+            best_memmem = t;
+    }
+    printf("strsearch case libc-strstr %.2f\n", (double)len / best_strstr / 1e9);
+    printf("strsearch case libc-memmem %.2f\n", (double)len / best_memmem / 1e9);
+
+    free(corpus);
+    return 0;
+}
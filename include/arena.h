@@ -0,0 +1,32 @@
+#ifndef CN_ARENA_H
+#define CN_ARENA_H
+
+/*
+ * arena.h
+ * Block arena for note text. Strings never move once stored, so the text
+ * columns of the database can point straight at them.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cheatnote.h"
+
+/* Room for `len` bytes, or NULL on allocation failure */
+char *cn_arena_alloc(cn_arena *a, size_t len);
+
+/* Copy s[0..len) plus a terminating NUL; returns the copy or NULL */
+const char *cn_arena_store(cn_arena *a, const char *s, size_t len);
+
+/* Copy n > 0 uint32_t values (suitably aligned); returns the copy or NULL */
+const uint32_t *cn_arena_store_u32(cn_arena *a, const uint32_t *v, size_t n);
+
+/* Count `size` bytes stored earlier as garbage (len + 1 for a string,
+ * n * sizeof(uint32_t) for values) */
+void cn_arena_release(cn_arena *a, size_t size);
+
+/* Whether the garbage outweighs the live text enough to rebuild the arena */
+int cn_arena_wants_compact(const cn_arena *a);
+
+void cn_arena_free(cn_arena *a);
+
+#endif /* CN_ARENA_H */
@@ -0,0 +1,21 @@
+#ifndef CN_BATCH_H
+#define CN_BATCH_H
+
+/*
+ * batch.h
+ * `cheatnote batch`: run many commands against one loaded database and
+ * save it once.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define CN_BATCH_MAX_ARGS 64 /* words per command line */
+
+/* Run every command line of `in` (name is used in messages). Changes are
+ * saved together at the end, and also after every `checkpoint` successful
+ * mutations if nonzero. Expects the database loaded under the exclusive
+ * lock. Returns 0 if every command succeeded, 1 otherwise. */
+int cn_batch_run(FILE *in, const char *name, size_t checkpoint);
+
+#endif /* CN_BATCH_H */
@@ -0,0 +1,42 @@
+#ifndef CN_BITMAP_H
+#define CN_BITMAP_H
+
+/*
+ * bitmap.h
+ * Compressed sets of 32-bit values (note ids) in the style of roaring
+ * bitmaps: one container per 2^16 values, a sorted array while sparse and
+ * a plain bitset once dense.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct cn_bitmap_container
+{
+    uint16_t key;    /* high 16 bits of every value inside */
+    uint32_t card;   /* values present */
+    uint32_t cap;    /* array capacity (array containers only) */
+    uint16_t *array; /* sorted low 16 bits, or NULL ... */
+    uint64_t *bits;  /* ... a 2^16-bit set once card exceeds the array limit */
+} cn_bitmap_container;
+
+typedef struct cn_bitmap
+{
+    cn_bitmap_container *containers; /* sorted by key */
+    size_t count;
+    size_t cap;
+} cn_bitmap;
+
+/* Insert v; returns 1 on success, 0 on allocation failure */
+int cn_bitmap_add(cn_bitmap *b, uint32_t v);
+void cn_bitmap_remove(cn_bitmap *b, uint32_t v);
+int cn_bitmap_contains(const cn_bitmap *b, uint32_t v);
+size_t cn_bitmap_cardinality(const cn_bitmap *b);
+void cn_bitmap_free(cn_bitmap *b);
+
+/* Call fn(v, ctx) for every value present in all `n` (> 0) bitmaps, in
+ * ascending order. Work is proportional to the smallest bitmap. */
+void cn_bitmap_intersect(const cn_bitmap *const *maps, size_t n,
+                         void (*fn)(uint32_t v, void *ctx), void *ctx);
+
+#endif /* CN_BITMAP_H */
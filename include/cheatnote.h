@@ -25,6 +25,7 @@
 #define MAX_CONTENT_LEN 8192
 #define MAX_TAGS_LEN 512
 #define MAX_TAG_COUNT 32
+#define MAX_PREVIEW_LEN 120 /* bytes of the first content line kept for list -c */
 #define MAX_SEARCH_LEN 256
 #define INITIAL_CAPACITY 64
 #define GROWTH_FACTOR 2
@@ -48,22 +49,92 @@
 
 /* === Data structures === */
 
-typedef struct cn_note
+/* A NUL-terminated string of known length (one entry of a text column) */
+typedef struct cn_text
+{
+    const char *str;
+    size_t len;
+} cn_text;
+
+/* A note's tags as sorted, unique ids in the tag dictionary (tags.h) */
+typedef struct cn_tag_list
+{
+    const uint32_t *ids;
+    size_t count;
+} cn_tag_list;
+
+/* Block arena owning heap note text (see arena.h) */
+typedef struct cn_arena
+{
+    char **blocks;
+    size_t nblocks;
+    size_t blocks_cap;
+    size_t block_size; /* size of the last block */
+    size_t block_used; /* bytes handed out from the last block */
+    size_t live;       /* bytes of stored strings still referenced */
+    size_t garbage;    /* bytes of released strings */
+} cn_arena;
+
+/*
+ * Read-only view of a note, gathered from the columns of the database.
+ * Fields point either into the heap text arenas or directly into a
+ * memory-mapped database file; they are NUL-terminated and valid until
+ * the note is changed or deleted, or the database reloaded or cleaned up.
+ */
+typedef struct cn_note_view
 {
     unsigned int id;
-    char title[MAX_TITLE_LEN];
-    char content[MAX_CONTENT_LEN];
-    char tags[MAX_TAGS_LEN];
+    const char *title;
+    const char *content;
+    const char *tags;
+    const char *preview; /* first line of content, shortened (see cn_note_preview) */
+    size_t title_len;
+    size_t content_len;
+    size_t tags_len;
+    size_t preview_len;
     time_t created_at;
     time_t modified_at;
-} cn_note;
+} cn_note_view;
 
+/*
+ * The loaded database, stored as parallel columns indexed by slot
+ * [0, count): filters on ids, timestamps, titles or tags read a few bytes
+ * per note and never touch the (cold) content column or its text.
+ */
 typedef struct cn_note_db
 {
-    cn_note *notes;
+    unsigned int *ids;
+    time_t *created_at;
+    time_t *modified_at;
+    cn_text *titles;
+    cn_text *tags;
+    cn_text *previews; /* compact-listing line, kept with the metadata */
+    cn_text *contents;
+    cn_tag_list *tag_ids; /* valid while the tag dictionary is built */
     size_t count;
     size_t capacity;
     unsigned int next_id;
+    unsigned int loaded_next_id; /* next_id at load: later ids are ours */
+
+    /* Heap mode: text owned by the process, titles, tags, previews (and
+     * tag id lists) in one arena and contents in another so metadata stays dense. */
+    cn_arena meta_text;
+    cn_arena content_text;
+
+    /* Persistence state: generation and random id of the base file on
+     * disk (id 0 if none or pre-v6) and the intact length of its
+     * write-ahead journal (0 if none). */
+    uint64_t generation;
+    uint64_t db_id;
+    size_t journal_len;
+    int legacy_base; /* base file still in the v1 layout (migrated on the next commit) */
+
+    /* Read-only mapped mode: the text columns point into the mapping at
+     * `map_base` (or into the mapped journal); only tag id lists and
+     * previews of journaled or pre-v5 records use the arenas. */
+    int readonly;
+    void *map_base;
+    size_t map_len;
 } cn_note_db;
 
 typedef struct cn_search_opts
@@ -14,10 +14,14 @@ int cn_cmd_list(int argc, char *argv[]);
 int cn_cmd_export(int argc, char *argv[]);
 int cn_cmd_import(int argc, char *argv[]);
 int cn_cmd_stats(int argc, char *argv[]);
+int cn_cmd_batch(int argc, char *argv[]);
+int cn_cmd_serve(int argc, char *argv[]);
 int cn_cmd_help(int argc, char *argv[]);
 int cn_cmd_version(int argc, char *argv[]);
 
 /* Dispatcher */
 int cn_commands_dispatch(int argc, char *argv[]);
+int cn_command_is_readonly(const char *cmd);
+int cn_command_rewrites_db(const char *cmd);
 
 #endif /* CN_COMMANDS_H */
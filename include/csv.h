@@ -0,0 +1,70 @@
+#ifndef CN_CSV_H
+#define CN_CSV_H
+
+/*
+ * csv.h
+ * Streaming RFC 4180 CSV reader that parses records in place.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define CN_CSV_BLOCK_SIZE (1u << 20) /* bytes read per fread */
+
+/* One field of the current record. `ptr` points into the reader's buffer,
+ * is NUL-terminated and stays valid until the next cn_csv_next call. */
+typedef struct cn_csv_field
+{
+    char *ptr;
+    size_t len;
+} cn_csv_field;
+
+typedef struct cn_csv_reader
+{
+    FILE *f;
+    char *buf;
+    size_t cap;      /* allocated bytes (block size + room for a record) */
+    size_t start;    /* first unconsumed byte */
+    size_t end;      /* end of buffered data */
+    size_t max_record;
+    size_t line;      /* line on which the last returned record starts */
+    int eof;
+
+    /* record scanner, resumable across refills */
+    size_t scan;      /* next byte to classify */
+    int state;        /* CN_CSV_S_* */
+    size_t rec_lines; /* newlines inside quotes in the current record */
+    size_t next_line; /* line on which the next record starts */
+} cn_csv_reader;
+
+/* Scanner states */
+enum
+{
+    CN_CSV_S_START = 0,
+    CN_CSV_S_UNQUOTED,
+    CN_CSV_S_QUOTED,
+    CN_CSV_S_QUOTE_IN_QUOTED,
+    CN_CSV_S_AFTER_QUOTED
+};
+
+/* Result of cn_csv_next */
+#define CN_CSV_RECORD 1
+#define CN_CSV_END 0
+#define CN_CSV_OVERLONG (-1) /* record longer than max_record: skipped */
+
+/* Start reading f. Records longer than max_record bytes are skipped.
+ * Returns 1 on success, 0 on allocation failure. */
+int cn_csv_open(cn_csv_reader *r, FILE *f, size_t max_record);
+void cn_csv_close(cn_csv_reader *r);
+
+/* Parse the next record into at most max_fields fields (extra fields are
+ * ignored, missing ones are returned empty). *nfields receives the number
+ * of fields present in the record, capped at max_fields (0 for a blank
+ * line). Returns CN_CSV_*. */
+int cn_csv_next(cn_csv_reader *r, cn_csv_field *fields, size_t max_fields, size_t *nfields);
+
+/* Rough number of records in f, from the file size and the density of the
+ * first block. Returns 0 if unknown. Does not move the read position. */
+size_t cn_csv_estimate_records(cn_csv_reader *r);
+
+#endif /* CN_CSV_H */
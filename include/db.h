@@ -6,12 +6,59 @@
  * Database lifecycle and persistence for CheatNote.
  */
 
+#include <stddef.h>
+#include "cheatnote.h"
+
 /* Lifecycle */
 void cn_db_init(void);
 void cn_db_load(void);
 void cn_db_save(void);
 void cn_db_cleanup(void);
 
+/* Columns: grow every column to `capacity` slots (1 on success), and copy
+ * every column of slot `from` over slot `to` */
+int cn_db_reserve(size_t capacity);
+void cn_db_move_note(size_t to, size_t from);
+
+/* Rebuild a text arena once the garbage left by replaced and deleted notes
+ * outweighs its live text (heap mode; call between mutations) */
+void cn_db_text_compact(void);
+
+/* Fields of a note changed by a command, for cn_db_commit_note */
+#define CN_FIELD_TITLE 1u
+#define CN_FIELD_CONTENT 2u
+#define CN_FIELD_TAGS 4u
+#define CN_FIELD_ALL (CN_FIELD_TITLE | CN_FIELD_CONTENT | CN_FIELD_TAGS)
+
+/* Durable single-note mutations: append to the journal instead of
+ * rewriting the database (compacted automatically past a threshold).
+ * Changes committed by other processes since the load are merged first:
+ * only the `fields` this process changed are re-applied to an edited note.
+ * cn_db_commit_note returns the note's final id (a new note may move). */
+unsigned int cn_db_commit_note(unsigned int id, unsigned int fields);
+void cn_db_commit_delete(unsigned int id);
+
+/* Batch mode: while enabled, cn_db_commit_* only note that the database
+ * changed, and cn_db_flush saves it in one rewrite (if anything changed).
+ * Hold the exclusive lock for the whole batch. */
+void cn_db_defer_commits(int enable);
+int cn_db_commits_pending(void);
+void cn_db_flush(void);
+
+/* Start a new unit of work on a long-lived loaded database (serve, batch):
+ * reload it if another process committed since, and from here on treat
+ * every note present as pre-existing for the merge in cn_db_commit_note. */
+void cn_db_refresh(void);
+
+/* Read-only access: map the file and view records in place.
+ * Mutating APIs must not be used after cn_db_open_readonly(). */
+void cn_db_open_readonly(void);
+void cn_db_note_view(size_t index, cn_note_view *out);
+unsigned int cn_db_note_id(size_t index);
+
+/* On-disk size of the database file in bytes (0 if missing) */
+size_t cn_db_file_size(void);
+
 /* Path helpers */
 const char *cn_get_db_path(void);
 void cn_set_db_path(const char *path);
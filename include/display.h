@@ -10,11 +10,11 @@
 void cn_set_use_colors(int enabled);
 
 /* Note rendering */
-void cn_print_note_full(const cn_note *note, int show_id);
-void cn_print_note_compact(const cn_note *note, int show_id);
-void cn_print_note_header(const cn_note *note, int show_id);
-void cn_print_note_content(const cn_note *note);
-void cn_print_note_timestamps(const cn_note *note);
+void cn_print_note_full(const cn_note_view *note, int show_id);
+void cn_print_note_compact(const cn_note_view *note, int show_id);
+void cn_print_note_header(const cn_note_view *note, int show_id);
+void cn_print_note_content(const cn_note_view *note);
+void cn_print_note_timestamps(const cn_note_view *note);
 void cn_print_note_footer(void);
 
 /* Status messages */
@@ -22,4 +22,9 @@ void cn_info_msg(const char *msg);
 void cn_success_msg(const char *msg);
 void cn_error_exit(const char *msg);
 
+/* Run handler (which must not return) instead of exiting on errors;
+ * NULL restores the default. Returns the handler set before. */
+typedef void (*cn_error_handler)(void);
+cn_error_handler cn_set_error_handler(cn_error_handler handler);
+
 #endif /* CN_DISPLAY_H */
@@ -0,0 +1,63 @@
+#ifndef CN_EXPORT_H
+#define CN_EXPORT_H
+
+/*
+ * export.h
+ * Block-buffered writers for `export` (CSV and JSON Lines).
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "cheatnote.h"
+
+#define CN_OUTBUF_FLUSH (1u << 20) /* flush once this many bytes are pending */
+
+/* Output buffer: formatted bytes accumulate here and reach `out` in large
+ * fwrite calls. With out == NULL nothing is flushed (in-memory buffer). */
+typedef struct cn_outbuf
+{
+    FILE *out;
+    char *data;
+    size_t len;
+    size_t cap;
+    int error; /* sticky: allocation or write failure */
+} cn_outbuf;
+
+void cn_outbuf_init(cn_outbuf *b, FILE *out);
+void cn_outbuf_put(cn_outbuf *b, const void *data, size_t len);
+void cn_outbuf_flush(cn_outbuf *b);
+void cn_outbuf_free(cn_outbuf *b);
+
+/* Append one note as a CSV row (quoted, "" escaped, terminated by \n) */
+void cn_csv_format_note(cn_outbuf *b, const cn_note_view *note);
+
+/* Append one note as a JSON object on its own line */
+void cn_jsonl_format_note(cn_outbuf *b, const cn_note_view *note);
+
+typedef enum cn_export_format
+{
+    CN_EXPORT_CSV = 0,
+    CN_EXPORT_JSONL,
+    CN_EXPORT_BIN /* binary snapshot, written by snapshot.c */
+} cn_export_format;
+
+/* "csv", "jsonl"/"ndjson" or "bin". Returns 0 for an unknown name. */
+int cn_export_format_parse(const char *name, cn_export_format *format);
+/* From the file extension (.jsonl/.ndjson, .cnb), CSV otherwise */
+cn_export_format cn_export_format_guess(const char *filename);
+const char *cn_export_format_name(cn_export_format format);
+
+/* Write every note of the loaded db (after the CSV header) in db order.
+ * Text formats only: snapshots are written by cn_snapshot_write.
+ * jobs as for `list --jobs` (<= 0: per core, 1: single-threaded).
+ * Returns 1 on success, 0 on a write or allocation error. */
+int cn_export_notes(FILE *out, cn_export_format format, int jobs);
+
+/* Split the export into `shards` files, each standalone (CSV ones with a
+ * header), written in parallel; shard k is named by cn_export_shard_path.
+ * Returns 1 on success. */
+int cn_export_shards(const char *filename, cn_export_format format, int shards, int jobs);
+int cn_export_shard_path(const char *filename, int shard, char *out, size_t out_sz);
+
+#endif /* CN_EXPORT_H */
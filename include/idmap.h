@@ -0,0 +1,22 @@
+#ifndef CN_IDMAP_H
+#define CN_IDMAP_H
+
+/*
+ * idmap.h
+ * id -> slot hash index over the loaded database (heap or mapped mode).
+ */
+
+#include <stddef.h>
+
+/* Rebuild from the current db contents; the last slot wins on duplicate ids */
+void cn_idmap_rebuild(void);
+void cn_idmap_clear(void);
+
+/* Slot of note `id`, or SIZE_MAX if absent */
+size_t cn_idmap_find(unsigned int id);
+
+/* Point `id` at `slot` (insert or update) / forget `id` */
+void cn_idmap_set(unsigned int id, size_t slot);
+void cn_idmap_remove(unsigned int id);
+
+#endif /* CN_IDMAP_H */
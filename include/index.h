@@ -0,0 +1,24 @@
+#ifndef CN_INDEX_H
+#define CN_INDEX_H
+
+/*
+ * index.h
+ * Persistent inverted index ("<db>.idx") used by `list -s` to narrow the
+ * notes that need full verification.
+ */
+
+#include "cheatnote.h"
+
+/* Prepare a candidate set for opts. Returns 1 if only candidates need to be
+ * checked (see cn_index_is_candidate), 0 if the caller must scan every note.
+ * Builds and persists the index when it is missing or stale. */
+int cn_index_lookup(const cn_search_opts *opts);
+int cn_index_is_candidate(unsigned int id);
+
+/* Incremental maintenance: a note was added, edited or deleted in memory */
+void cn_index_touch(unsigned int id);
+
+/* Release the loaded index and candidate set */
+void cn_index_close(void);
+
+#endif /* CN_INDEX_H */
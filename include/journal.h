@@ -0,0 +1,58 @@
+#ifndef CN_JOURNAL_H
+#define CN_JOURNAL_H
+
+/*
+ * journal.h
+ * Append-only write-ahead log ("<db>.wal") for CheatNote mutations.
+ *
+ * The journal only frames, checksums and persists entries; the payload of
+ * a PUT is an opaque database record produced and interpreted by db.c.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Entry operations */
+#define CN_JOURNAL_PUT 1u /* insert or replace a note (payload: full record) */
+#define CN_JOURNAL_DEL 2u /* delete a note by id (no payload) */
+
+typedef struct cn_journal_entry
+{
+    uint32_t op;
+    unsigned int id;
+    time_t timestamp;
+    const unsigned char *payload;
+    size_t payload_len;
+} cn_journal_entry;
+
+/* An opened (read-only) journal. Entries point into `base`. */
+typedef struct cn_journal
+{
+    unsigned char *base;
+    size_t len;       /* bytes available at base */
+    size_t valid_len; /* length of the intact prefix (header + whole entries) */
+    size_t pos;       /* iteration cursor */
+    int mapped;
+} cn_journal;
+
+/* Path of the journal belonging to db_path. Returns 1 on success. */
+int cn_journal_path(const char *db_path, char *out, size_t out_sz);
+
+/* Open the journal for db_path if it exists and belongs to base_generation.
+ * Returns 1 if entries may be iterated, 0 if there is no usable journal. */
+int cn_journal_open(cn_journal *j, const char *db_path, uint64_t base_generation);
+int cn_journal_next(cn_journal *j, cn_journal_entry *out);
+void cn_journal_close(cn_journal *j);
+
+/* Durably append one entry (write + fsync). `valid_len` is the intact length
+ * known to the caller (0 starts a new journal for base_generation); any torn
+ * tail beyond it is discarded first. Returns the new journal length, 0 on error. */
+size_t cn_journal_append(const char *db_path, uint64_t base_generation, size_t valid_len,
+                         uint32_t op, unsigned int id, time_t timestamp,
+                         const void *payload, size_t payload_len);
+
+/* Remove the journal (after its entries were folded into the base file). */
+void cn_journal_remove(const char *db_path);
+
+#endif /* CN_JOURNAL_H */
@@ -0,0 +1,54 @@
+#ifndef CN_JSONL_H
+#define CN_JSONL_H
+
+/*
+ * jsonl.h
+ * Streaming JSON Lines (NDJSON) reader that parses note objects in place.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define CN_JSONL_BLOCK_SIZE (1u << 20) /* bytes read per fread */
+
+/* One note object. String members point into the reader's buffer, are
+ * NUL-terminated and stay valid until the next cn_jsonl_next call; absent
+ * or null members are empty strings. "tags" may be a string or an array of
+ * strings (joined with ','). */
+typedef struct cn_jsonl_note
+{
+    char *title, *content, *tags;
+    size_t title_len, content_len, tags_len;
+    long long id, created, modified; /* 0 when absent */
+} cn_jsonl_note;
+
+typedef struct cn_jsonl_reader
+{
+    FILE *f;
+    char *buf;
+    size_t cap;   /* allocated bytes (block size + room for a record) */
+    size_t start; /* first unconsumed byte */
+    size_t end;   /* end of buffered data */
+    size_t scan;  /* bytes before this are known to hold no newline */
+    size_t max_record;
+    size_t line; /* line number of the last returned record */
+    int eof;
+} cn_jsonl_reader;
+
+/* Result of cn_jsonl_next */
+#define CN_JSONL_RECORD 1
+#define CN_JSONL_END 0
+#define CN_JSONL_OVERLONG (-1) /* line longer than max_record: skipped */
+#define CN_JSONL_INVALID (-2)  /* not a JSON object: skipped */
+
+/* Start reading f. Returns 1 on success, 0 on allocation failure. */
+int cn_jsonl_open(cn_jsonl_reader *r, FILE *f, size_t max_record);
+void cn_jsonl_close(cn_jsonl_reader *r);
+
+/* Parse the next non-blank line into *note. Returns CN_JSONL_*. */
+int cn_jsonl_next(cn_jsonl_reader *r, cn_jsonl_note *note);
+
+/* Rough number of records in f, as cn_csv_estimate_records. */
+size_t cn_jsonl_estimate_records(cn_jsonl_reader *r);
+
+#endif /* CN_JSONL_H */
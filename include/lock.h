@@ -0,0 +1,32 @@
+#ifndef CN_LOCK_H
+#define CN_LOCK_H
+
+/*
+ * lock.h
+ * Cross-process coordination: advisory database lock and unique temp files.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Lock modes, weakest first */
+#define CN_LOCK_NONE 0
+#define CN_LOCK_SHARED 1    /* readers: any number at once */
+#define CN_LOCK_EXCLUSIVE 2 /* writers: alone */
+
+#define CN_LOCK_TIMEOUT_MS 30000 /* give up waiting after this long */
+
+/* Hold the database lock ("<db>.lock") in at least `mode`, retrying with
+ * backoff while another process holds it. Returns the mode held before,
+ * for cn_db_lock_restore. Exits if the lock cannot be had in time. */
+int cn_db_lock(int mode);
+
+/* Go back to a mode returned by cn_db_lock (releasing or downgrading) */
+void cn_db_lock_restore(int mode);
+
+/* Open a new, uniquely named temporary file next to `path` for writing
+ * ("<path>.tmp.XXXXXX") with the mode of `path` (0666 & ~umask if it does
+ * not exist); its name is stored in tmp. Returns NULL on failure. */
+FILE *cn_temp_open(const char *path, char *tmp, size_t tmp_sz);
+
+#endif /* CN_LOCK_H */
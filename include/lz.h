@@ -0,0 +1,22 @@
+#ifndef CN_LZ_H
+#define CN_LZ_H
+
+/*
+ * lz.h
+ * Small LZ77 block codec (LZ4-style sequences) for binary snapshots.
+ */
+
+#include <stddef.h>
+
+/* Worst-case output of cn_lz_compress for n input bytes */
+#define CN_LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+/* Compress src[0..n) into dst (cap bytes). Returns the compressed size, or
+ * 0 if it would not fit (store the block raw instead). */
+size_t cn_lz_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap);
+
+/* Decompress src[0..n) into dst (cap bytes). Returns the number of bytes
+ * produced, or (size_t)-1 if the input is malformed or overflows dst. */
+size_t cn_lz_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap);
+
+#endif /* CN_LZ_H */
@@ -6,9 +6,23 @@
  * CRUD operations for notes: add, edit, delete.
  */
 
+#include "cheatnote.h"
+
 /* CRUD */
 unsigned int cn_note_add(const char *title, const char *content, const char *tags);
 int cn_note_edit(unsigned int id, const char *title, const char *content, const char *tags);
 int cn_note_delete(unsigned int id);
 
+/* Pre-size the notes array for `extra` more notes (bulk import) */
+int cn_note_reserve(size_t extra);
+
+/* Compact preview of `content`: its first line, cut to fit MAX_PREVIEW_LEN
+ * bytes (at a UTF-8 boundary, ending in "...") if longer. Writes it with a
+ * terminating NUL to `out` and returns its length. */
+size_t cn_note_preview(const char *content, size_t content_len, char out[MAX_PREVIEW_LEN + 1]);
+
+/* Insert or replace a note verbatim (id, text, timestamps), e.g. on replay.
+ * The text is copied into the string arena and must not point into it. */
+int cn_note_put(const cn_note_view *note);
+
 #endif /* CN_NOTES_IO_H */
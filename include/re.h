@@ -0,0 +1,27 @@
+#ifndef CN_RE_H
+#define CN_RE_H
+
+/*
+ * re.h
+ * Built-in POSIX extended regular expressions, matched in linear time by a
+ * lazily built DFA (see re.c).
+ */
+
+#include <stddef.h>
+
+/* Compile flags */
+#define CN_RE_ICASE 1   /* ASCII case folding */
+#define CN_RE_NEWLINE 2 /* `.` and [^...] skip '\n'; ^ and $ also match at line breaks */
+
+typedef struct cn_re cn_re;
+
+/* Compile an ERE. Returns NULL on an invalid or unsupported pattern
+ * (back-references) or on allocation failure. */
+cn_re *cn_re_compile(const char *pattern, int flags);
+void cn_re_free(cn_re *re);
+
+/* Whether the pattern matches anywhere in text[0..len). Returns 1 or 0, or
+ * -1 on allocation failure. Safe to call concurrently on one cn_re. */
+int cn_re_search(const cn_re *re, const char *text, size_t len);
+
+#endif /* CN_RE_H */
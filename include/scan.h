@@ -0,0 +1,24 @@
+#ifndef CN_SCAN_H
+#define CN_SCAN_H
+
+/*
+ * scan.h
+ * Evaluate a search over the whole database, optionally on several threads.
+ */
+
+#include <stddef.h>
+
+#include "cheatnote.h"
+
+/* Mark every note matching opts: hits[i] is set to 1 for db slot i, 0
+ * otherwise (hits must hold db.count bytes). When `indexed` is set only
+ * notes accepted by cn_index_is_candidate are evaluated.
+ * jobs <= 0 sizes the pool from the online core count; 1 scans inline.
+ * Returns the number of matches, or -1 if the query could not be compiled
+ * or evaluated (out of memory); the caller reports it on its own thread. */
+long cn_scan_notes(const cn_search_opts *opts, int indexed, int jobs, unsigned char *hits);
+
+/* Worker count actually used for `count` notes given a --jobs value */
+int cn_scan_jobs(int jobs, size_t count);
+
+#endif /* CN_SCAN_H */
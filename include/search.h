@@ -7,8 +7,17 @@
  */
 
 #include "cheatnote.h"
-/* Tag & content matching */
+
+/* Prepared queries: compile once, evaluate against many notes */
+typedef struct cn_matcher cn_matcher;
+
+cn_matcher *cn_matcher_compile(const cn_search_opts *opts);
+/* 1 on a match, 0 if none, -1 on allocation failure (never exits) */
+int cn_matcher_match(const cn_matcher *m, const cn_note_view *note);
+void cn_matcher_free(cn_matcher *m);
+
+/* Tag & content matching (one-shot) */
 int cn_note_match_tags(const char *note_tags, const char *search_tags);
-int cn_note_match_content(const cn_note *note, const cn_search_opts *opts);
+int cn_note_match_content(const cn_note_view *note, const cn_search_opts *opts);
 
 #endif /* CN_SEARCH_H */
@@ -0,0 +1,20 @@
+#ifndef CN_SERVE_H
+#define CN_SERVE_H
+
+/*
+ * serve.h
+ * `cheatnote serve`: keep the database loaded and run commands sent over
+ * a Unix domain socket ("<db>.sock"), and the client side that forwards
+ * CLI invocations to it.
+ */
+
+/* Serve requests until SIGINT/SIGTERM. Expects the database loaded.
+ * Returns the exit code for the serve command. */
+int cn_serve_run(void);
+
+/* Run argv (a full command line, argv[0] included) in the daemon serving
+ * the current database, if one is listening. Returns 1 and stores the
+ * command's exit code in *rc if it ran there, 0 to run it locally. */
+int cn_serve_forward(int argc, char *argv[], int *rc);
+
+#endif /* CN_SERVE_H */
@@ -0,0 +1,52 @@
+#ifndef CN_SNAPSHOT_H
+#define CN_SNAPSHOT_H
+
+/*
+ * snapshot.h
+ * Portable binary snapshots (`export --format=bin`) for backup and restore.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cheatnote.h"
+
+#define CN_SNAPSHOT_MAGIC "CNBK"
+#define CN_SNAPSHOT_VERSION 1u
+#define CN_SNAPSHOT_HEADER_SIZE 40u
+#define CN_SNAPSHOT_BLOCK_SIZE (1u << 20) /* raw payload bytes per block */
+
+#define CN_SNAPSHOT_LZ 1u /* header flag: blocks may be LZ-compressed */
+
+/* A snapshot read into memory: the whole payload in one allocation */
+typedef struct cn_snapshot
+{
+    unsigned char *payload;
+    size_t payload_len;
+    size_t count;
+    unsigned int next_id;
+    uint32_t flags;
+    size_t pos; /* iteration cursor into payload */
+} cn_snapshot;
+
+/* CRC-32 (IEEE 802.3, as zlib) of len bytes, continuing from crc (0 to start) */
+uint32_t cn_crc32(uint32_t crc, const void *data, size_t len);
+
+/* Write every note of the loaded db as a snapshot, LZ-compressing blocks
+ * when compress is set. Returns 1 on success, 0 on a write error. */
+int cn_snapshot_write(FILE *out, int compress);
+
+/* Nonzero if the first bytes of f are a snapshot header. Rewinds f. */
+int cn_snapshot_detect(FILE *f);
+
+/* Read and verify a whole snapshot (header, block checksums, record
+ * framing). Returns 1 on success; on failure *err describes the problem. */
+int cn_snapshot_read(FILE *f, cn_snapshot *s, const char **err);
+
+/* Next note of the snapshot as a view into its payload. Returns 0 at the end. */
+int cn_snapshot_next(cn_snapshot *s, cn_note_view *note);
+
+void cn_snapshot_free(cn_snapshot *s);
+
+#endif /* CN_SNAPSHOT_H */
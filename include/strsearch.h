@@ -0,0 +1,50 @@
+#ifndef CN_STRSEARCH_H
+#define CN_STRSEARCH_H
+
+/*
+ * strsearch.h
+ * Substring search kernels with an optional ASCII case-folding mode.
+ */
+
+#include <stddef.h>
+
+/* Scan kernels. CN_KERNEL_AUTO picks the widest one the CPU supports. */
+enum
+{
+    CN_KERNEL_AUTO = 0,
+    CN_KERNEL_SCALAR,
+    CN_KERNEL_SSE2,
+    CN_KERNEL_AVX2
+};
+
+struct cn_finder;
+typedef const char *(*cn_find_fn)(const struct cn_finder *f, const unsigned char *hay,
+                                  size_t hay_len);
+
+/* A prepared needle. Case-insensitive finders store the needle folded and
+ * fold haystack bytes on the fly, so searching never allocates. */
+typedef struct cn_finder
+{
+    unsigned char *needle;
+    size_t len;
+    int icase;
+    int kernel;       /* CN_KERNEL_* actually in use */
+    cn_find_fn find;  /* selected at init, never changes under readers */
+    size_t skip[256]; /* Horspool shift per (folded) byte */
+} cn_finder;
+
+/* Returns 1 on success, 0 on allocation failure */
+int cn_finder_init(cn_finder *f, const char *needle, size_t len, int icase);
+void cn_finder_free(cn_finder *f);
+
+/* Force a scan kernel (benchmarks). Returns 0 if the CPU lacks it. */
+int cn_finder_set_kernel(cn_finder *f, int kernel);
+const char *cn_finder_kernel_name(const cn_finder *f);
+
+/* First occurrence of the needle in hay[0..hay_len), or NULL */
+const char *cn_finder_find(const cn_finder *f, const char *hay, size_t hay_len);
+
+/* 1 if hay[0..hay_len) equals the needle (under folding if icase) */
+int cn_finder_equals(const cn_finder *f, const char *hay, size_t hay_len);
+
+#endif /* CN_STRSEARCH_H */
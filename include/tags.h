@@ -0,0 +1,35 @@
+#ifndef CN_TAGS_H
+#define CN_TAGS_H
+
+/*
+ * tags.h
+ * Interned tag dictionary: tag name -> small integer id, each note's
+ * sorted tag-id list (db.tag_ids) and one bitmap of note ids per tag, so
+ * a tag filter is an exact set intersection.
+ */
+
+#include <stddef.h>
+
+/* Normalized tags of a tags string: comma-separated, surrounding
+ * whitespace trimmed, ASCII letters lowercased, empty ones skipped.
+ * Copies the next tag of s[*pos..len) into out (MAX_TAGS_LEN bytes) and
+ * returns its length, or 0 when none is left. */
+size_t cn_tag_next(const char *s, size_t len, size_t *pos, char *out);
+
+/* Build the dictionary from the loaded database (once; kept up to date by
+ * the calls below afterwards). Returns 1 on success, 0 on allocation
+ * failure. cn_tags_clear drops it, e.g. when the database is unloaded. */
+int cn_tags_build(void);
+void cn_tags_clear(void);
+
+/* Mirror a change to the note at `slot` (no-ops until built): forget its
+ * tags before they or its id change, index them again afterwards. */
+void cn_tags_forget(size_t slot);
+void cn_tags_index(size_t slot);
+
+/* Set hits[slot] to 1 for every note carrying all tags of `filter` and
+ * to 0 for the others. Returns the number of hits, or -1 on allocation
+ * failure. */
+long cn_tags_select(const char *filter, unsigned char *hits);
+
+#endif /* CN_TAGS_H */
@@ -0,0 +1,95 @@
+/*
+ * src/arena.c
+ *
+ * Block arena behind the text columns of the heap database.
+ *
+ * - Strings are appended to fixed-size blocks (larger requests get a block
+ *   of their own) and are never moved, so db.titles / db.tags /
+ *   db.contents hold plain pointers that stay valid while notes are added.
+ * - Nothing is freed individually: replaced and deleted text is only
+ *   counted as garbage. Once the garbage is large and outweighs the live
+ *   text, db.c copies the live strings into a fresh arena and frees the old
+ *   one (cn_db_text_compact), which keeps the cost linear in the text
+ *   written.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cheatnote.h"
+#include "arena.h"
+
+#define ARENA_BLOCK_SIZE (256u << 10)
+#define ARENA_COMPACT_MIN (1u << 20) /* least garbage worth a rebuild */
+
+char *cn_arena_alloc(cn_arena *a, size_t len)
+{
+    if (a->nblocks == 0 || a->block_size - a->block_used < len)
+    {
+        size_t size = len > ARENA_BLOCK_SIZE ? len : ARENA_BLOCK_SIZE;
+        if (a->nblocks == a->blocks_cap)
+        {
+            size_t cap = a->blocks_cap ? a->blocks_cap * GROWTH_FACTOR : 16;
+            char **blocks = realloc(a->blocks, cap * sizeof(*blocks));
+            if (!blocks)
+                return NULL;
+            a->blocks = blocks;
+            a->blocks_cap = cap;
+        }
+        char *block = malloc(size);
+        if (!block)
+            return NULL;
+        a->blocks[a->nblocks++] = block;
+        a->block_size = size;
+        a->block_used = 0;
+    }
+
+    char *p = a->blocks[a->nblocks - 1] + a->block_used;
+    a->block_used += len;
+    a->live += len;
+    return p;
+}
+
+const char *cn_arena_store(cn_arena *a, const char *s, size_t len)
+{
+    char *p = cn_arena_alloc(a, len + 1);
+    if (!p)
+        return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+const uint32_t *cn_arena_store_u32(cn_arena *a, const uint32_t *v, size_t n)
+{
+    /* Blocks come from malloc, so aligning the offset aligns the pointer;
+     * the padding is neither live nor garbage */
+    size_t pad = (sizeof(uint32_t) - a->block_used % sizeof(uint32_t)) % sizeof(uint32_t);
+    if (a->nblocks > 0 && a->block_size - a->block_used >= pad)
+        a->block_used += pad; /* else a new block is started, aligned */
+
+    uint32_t *p = (uint32_t *)(void *)cn_arena_alloc(a, n * sizeof(*v));
+    if (!p)
+        return NULL;
+    memcpy(p, v, n * sizeof(*v));
+    return p;
+}
+
+void cn_arena_release(cn_arena *a, size_t size)
+{
+    a->live -= size;
+    a->garbage += size;
+}
+
+int cn_arena_wants_compact(const cn_arena *a)
+{
+    return a->garbage >= ARENA_COMPACT_MIN && a->garbage >= a->live;
+}
+
+void cn_arena_free(cn_arena *a)
+{
+    for (size_t i = 0; i < a->nblocks; ++i)
+        free(a->blocks[i]);
+    free(a->blocks);
+    memset(a, 0, sizeof(*a));
+}
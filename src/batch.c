@@ -0,0 +1,207 @@
+/*
+ * src/batch.c
+ *
+ * Batch mode (`cheatnote batch`): many commands, one load and one save.
+ *
+ * - Input is one command per line, written as on the command line without
+ *   the program name: `add "Title" "Content" tags`, `edit 5 -t New`,
+ *   `delete 7`, `list -s foo -c`, `stats`. Blank lines and lines starting
+ *   with '#' are ignored.
+ * - Words are split like a POSIX shell would for simple cases: whitespace
+ *   separates words, '...' is literal, "..." allows \" \\ and the escapes
+ *   \n and \t (so multi-line content fits on one line), and a backslash
+ *   outside quotes takes the next character literally.
+ * - Each line runs through the normal dispatcher against the in-memory
+ *   database. cn_db_defer_commits turns the per-note journal commits into
+ *   a dirty flag, and cn_db_flush writes the whole database once at the
+ *   end (and every `--checkpoint N` successful mutations). main() holds
+ *   the exclusive lock for the whole batch (cn_command_rewrites_db), so no
+ *   other process commits in between.
+ * - A failing line (cn_error_exit) is reported with its line number and
+ *   the batch goes on; the exit code is 1 if any line failed.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "cheatnote.h"
+#include "batch.h"
+#include "commands.h"
+#include "db.h"
+#include "display.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static jmp_buf line_jmp;
+
+/* Reached only from the thread that called setjmp in run_line: a `list`
+ * line's scan workers report failures to it instead (scan.c) */
+static void on_error(void)
+{
+    longjmp(line_jmp, 1);
+}
+
+/* Split line into words in place (see the file comment for the rules).
+ * Returns the number of words, or -1 with *err set. */
+static int split_words(char *line, char **words, int max_words, const char **err)
+{
+    int n = 0;
+    char *p = line;
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            ++p;
+        if (*p == '\0')
+            return n;
+        if (n == max_words)
+        {
+            *err = "too many words";
+            return -1;
+        }
+
+        char *w = p;
+        words[n++] = w;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        {
+            if (*p == '\'')
+            {
+                char *q = strchr(p + 1, '\'');
+                if (!q)
+                {
+                    *err = "unterminated '";
+                    return -1;
+                }
+                size_t len = (size_t)(q - p - 1);
+                memmove(w, p + 1, len);
+                w += len;
+                p = q + 1;
+            }
+            else if (*p == '"')
+            {
+                ++p;
+                while (*p && *p != '"')
+                {
+                    if (*p == '\\' && p[1])
+                    {
+                        ++p;
+                        *w++ = *p == 'n' ? '\n' : *p == 't' ? '\t' : *p;
+                        ++p;
+                    }
+                    else
+                    {
+                        *w++ = *p++;
+                    }
+                }
+                if (*p != '"')
+                {
+                    *err = "unterminated \"";
+                    return -1;
+                }
+                ++p;
+            }
+            else if (*p == '\\' && p[1])
+            {
+                *w++ = p[1];
+                p += 2;
+            }
+            else
+            {
+                *w++ = *p++;
+            }
+        }
+        if (*p)
+            ++p; /* the separator may be overwritten by the terminator */
+        *w = '\0';
+    }
+}
+
+static int is_batch_command(const char *cmd)
+{
+    return strcmp(cmd, "add") == 0 || strcmp(cmd, "edit") == 0 || strcmp(cmd, "delete") == 0 ||
+           strcmp(cmd, "list") == 0 || strcmp(cmd, "stats") == 0;
+}
+
+static int is_mutation(const char *cmd)
+{
+    return strcmp(cmd, "add") == 0 || strcmp(cmd, "edit") == 0 || strcmp(cmd, "delete") == 0;
+}
+
+/* Run one command line; returns its exit code (EXIT_FAILURE on error).
+ * An error longjmps back here, always from this thread. */
+static int run_line(int argc, char **argv)
+{
+    volatile int rc = EXIT_FAILURE;
+    cn_error_handler prev = cn_set_error_handler(on_error);
+    if (setjmp(line_jmp) == 0)
+        rc = cn_commands_dispatch(argc, argv);
+    cn_set_error_handler(prev);
+    fflush(stdout);
+    return rc;
+}
+
+int cn_batch_run(FILE *in, const char *name, size_t checkpoint)
+{
+    char *line = NULL;
+    size_t line_cap = 0;
+    size_t line_no = 0, commands = 0, failed = 0, since_checkpoint = 0;
+    char *argv[CN_BATCH_MAX_ARGS + 2];
+
+    cn_db_defer_commits(1);
+    argv[0] = "cheatnote";
+
+    while (getline(&line, &line_cap, in) != -1)
+    {
+        ++line_no;
+        const char *err = NULL;
+        int n = split_words(line, argv + 1, CN_BATCH_MAX_ARGS, &err);
+        if (n == 0 || (n > 0 && argv[1][0] == '#'))
+            continue;
+
+        ++commands;
+        int rc;
+        if (n < 0)
+        {
+            fprintf(stderr, "Error: %s\n", err);
+            rc = EXIT_FAILURE;
+        }
+        else if (!is_batch_command(argv[1]))
+        {
+            fprintf(stderr, "Error: '%s' cannot be used in a batch (use add, edit, delete, list or stats)\n", argv[1]);
+            rc = EXIT_FAILURE;
+        }
+        else
+        {
+            argv[n + 1] = NULL;
+            rc = run_line(n + 1, argv);
+        }
+
+        if (rc != 0)
+        {
+            fprintf(stderr, "%sWarning:%s %s line %zu failed\n",
+                    use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", name, line_no);
+            ++failed;
+        }
+        else if (checkpoint && is_mutation(argv[1]) && ++since_checkpoint >= checkpoint)
+        {
+            cn_db_flush();
+            since_checkpoint = 0;
+        }
+    }
+    int read_error = ferror(in);
+    free(line);
+
+    cn_db_flush();
+    cn_db_defer_commits(0);
+
+    if (read_error)
+        cn_error_exit("Error reading batch input");
+    printf("Batch complete: %zu commands", commands);
+    if (failed > 0)
+        printf(" (%s%zu%s failed)", use_colors ? COLOR_YELLOW : "", failed, use_colors ? COLOR_RESET : "");
+    printf("\n");
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+/*
+ * src/bitmap.c
+ *
+ * Roaring-style compressed bitmaps for the tag dictionary (tags.c).
+ *
+ * - A value's high 16 bits select a container, kept sorted by key so a
+ *   lookup is a binary search over at most 2^16 containers.
+ * - A container holds its low 16 bits in a sorted uint16 array up to
+ *   BITMAP_ARRAY_MAX values (8 KiB, the size of a full bitset) and
+ *   switches to a 1024-word bitset beyond that; it switches back when
+ *   removals bring it to half the limit, so add/remove churn around the
+ *   boundary does not convert every time.
+ * - Intersection walks the smallest bitmap and probes the others, so its
+ *   cost follows the rarest tag, not the number of notes.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitmap.h"
+
+#define BITMAP_ARRAY_MAX 4096
+#define BITMAP_WORDS (65536 / 64)
+
+/* Index of the container with `key`, or -(insertion point) - 1 */
+static long find_container(const cn_bitmap *b, uint16_t key)
+{
+    size_t lo = 0, hi = b->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (b->containers[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < b->count && b->containers[lo].key == key)
+        return (long)lo;
+    return -(long)lo - 1;
+}
+
+/* Position of `low` in a sorted array, or where it would be inserted */
+static size_t array_lower_bound(const uint16_t *a, size_t n, uint16_t low)
+{
+    size_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int container_contains(const cn_bitmap_container *c, uint16_t low)
+{
+    if (c->bits)
+        return (c->bits[low >> 6] >> (low & 63)) & 1;
+    size_t i = array_lower_bound(c->array, c->card, low);
+    return i < c->card && c->array[i] == low;
+}
+
+/* Convert a full array container into a bitset */
+static int to_bits(cn_bitmap_container *c)
+{
+    uint64_t *bits = calloc(BITMAP_WORDS, sizeof(*bits));
+    if (!bits)
+        return 0;
+    for (uint32_t i = 0; i < c->card; ++i)
+        bits[c->array[i] >> 6] |= (uint64_t)1 << (c->array[i] & 63);
+    free(c->array);
+    c->array = NULL;
+    c->cap = 0;
+    c->bits = bits;
+    return 1;
+}
+
+/* Convert a sparse bitset container back into an array (best effort) */
+static void to_array(cn_bitmap_container *c)
+{
+    uint16_t *array = malloc(c->card * sizeof(*array) + sizeof(*array));
+    if (!array)
+        return;
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+    {
+        for (uint64_t word = c->bits[w]; word; word &= word - 1)
+            array[n++] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(word));
+    }
+    free(c->bits);
+    c->bits = NULL;
+    c->array = array;
+    c->cap = c->card + 1;
+}
+
+int cn_bitmap_add(cn_bitmap *b, uint32_t v)
+{
+    uint16_t key = (uint16_t)(v >> 16), low = (uint16_t)v;
+    long at = find_container(b, key);
+    if (at < 0)
+    {
+        size_t pos = (size_t)(-at - 1);
+        if (b->count == b->cap)
+        {
+            size_t cap = b->cap ? b->cap * 2 : 4;
+            cn_bitmap_container *grown = realloc(b->containers, cap * sizeof(*grown));
+            if (!grown)
+                return 0;
+            b->containers = grown;
+            b->cap = cap;
+        }
+        memmove(&b->containers[pos + 1], &b->containers[pos],
+                (b->count - pos) * sizeof(*b->containers));
+        memset(&b->containers[pos], 0, sizeof(*b->containers));
+        b->containers[pos].key = key;
+        b->count++;
+        at = (long)pos;
+    }
+
+    cn_bitmap_container *c = &b->containers[at];
+    if (c->bits)
+    {
+        uint64_t bit = (uint64_t)1 << (low & 63);
+        if (!(c->bits[low >> 6] & bit))
+        {
+            c->bits[low >> 6] |= bit;
+            c->card++;
+        }
+        return 1;
+    }
+
+    size_t i = array_lower_bound(c->array, c->card, low);
+    if (i < c->card && c->array[i] == low)
+        return 1;
+    if (c->card == BITMAP_ARRAY_MAX)
+    {
+        if (!to_bits(c))
+            return 0;
+        c->bits[low >> 6] |= (uint64_t)1 << (low & 63);
+        c->card++;
+        return 1;
+    }
+    if (c->card == c->cap)
+    {
+        uint32_t cap = c->cap ? c->cap * 2 : 4;
+        if (cap > BITMAP_ARRAY_MAX)
+            cap = BITMAP_ARRAY_MAX;
+        uint16_t *grown = realloc(c->array, cap * sizeof(*grown));
+        if (!grown)
+            return 0;
+        c->array = grown;
+        c->cap = cap;
+    }
+    memmove(&c->array[i + 1], &c->array[i], (c->card - i) * sizeof(*c->array));
+    c->array[i] = low;
+    c->card++;
+    return 1;
+}
+
+void cn_bitmap_remove(cn_bitmap *b, uint32_t v)
+{
+    uint16_t low = (uint16_t)v;
+    long at = find_container(b, (uint16_t)(v >> 16));
+    if (at < 0)
+        return;
+
+    cn_bitmap_container *c = &b->containers[at];
+    if (c->bits)
+    {
+        uint64_t bit = (uint64_t)1 << (low & 63);
+        if (!(c->bits[low >> 6] & bit))
+            return;
+        c->bits[low >> 6] &= ~bit;
+        if (--c->card <= BITMAP_ARRAY_MAX / 2)
+            to_array(c);
+        return;
+    }
+
+    size_t i = array_lower_bound(c->array, c->card, low);
+    if (i >= c->card || c->array[i] != low)
+        return;
+    memmove(&c->array[i], &c->array[i + 1], (c->card - i - 1) * sizeof(*c->array));
+    if (--c->card > 0)
+        return;
+
+    /* Drop the empty container */
+    free(c->array);
+    memmove(c, c + 1, (b->count - (size_t)at - 1) * sizeof(*c));
+    b->count--;
+}
+
+int cn_bitmap_contains(const cn_bitmap *b, uint32_t v)
+{
+    long at = find_container(b, (uint16_t)(v >> 16));
+    return at >= 0 && container_contains(&b->containers[at], (uint16_t)v);
+}
+
+size_t cn_bitmap_cardinality(const cn_bitmap *b)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < b->count; ++i)
+        n += b->containers[i].card;
+    return n;
+}
+
+void cn_bitmap_free(cn_bitmap *b)
+{
+    for (size_t i = 0; i < b->count; ++i)
+    {
+        free(b->containers[i].array);
+        free(b->containers[i].bits);
+    }
+    free(b->containers);
+    memset(b, 0, sizeof(*b));
+}
+
+/* Whether `low` is in the key's container of every map but `skip` */
+static int in_all(const cn_bitmap_container *const *cs, size_t n, size_t skip, uint16_t low)
+{
+    for (size_t k = 0; k < n; ++k)
+    {
+        if (k != skip && !container_contains(cs[k], low))
+            return 0;
+    }
+    return 1;
+}
+
+void cn_bitmap_intersect(const cn_bitmap *const *maps, size_t n,
+                         void (*fn)(uint32_t v, void *ctx), void *ctx)
+{
+    size_t smallest = 0;
+    for (size_t k = 1; k < n; ++k)
+    {
+        if (cn_bitmap_cardinality(maps[k]) < cn_bitmap_cardinality(maps[smallest]))
+            smallest = k;
+    }
+
+    const cn_bitmap_container **cs = malloc(n * sizeof(*cs));
+    if (!cs)
+        return;
+
+    const cn_bitmap *base = maps[smallest];
+    for (size_t i = 0; i < base->count; ++i)
+    {
+        const cn_bitmap_container *c = &base->containers[i];
+        int present = 1;
+        for (size_t k = 0; k < n && present; ++k)
+        {
+            long at = find_container(maps[k], c->key);
+            present = at >= 0;
+            if (present)
+                cs[k] = &maps[k]->containers[at];
+        }
+        if (!present)
+            continue;
+
+        uint32_t high = (uint32_t)c->key << 16;
+        if (!c->bits)
+        {
+            for (uint32_t j = 0; j < c->card; ++j)
+            {
+                if (in_all(cs, n, smallest, c->array[j]))
+                    fn(high | c->array[j], ctx);
+            }
+        }
+        else
+        {
+            for (uint32_t w = 0; w < BITMAP_WORDS; ++w)
+            {
+                /* AND the words of the other bitset containers up front */
+                uint64_t word = c->bits[w];
+                for (size_t k = 0; k < n && word; ++k)
+                {
+                    if (cs[k]->bits)
+                        word &= cs[k]->bits[w];
+                }
+                for (; word; word &= word - 1)
+                {
+                    uint16_t low = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(word));
+                    if (in_all(cs, n, smallest, low))
+                        fn(high | low, ctx);
+                }
+            }
+        }
+    }
+    free(cs);
+}
@@ -1,7 +1,8 @@
 /*
  * src/commands.c
  *
- * CLI command implementations (add, edit, delete, list, import, export, stats, help, version).
+ * CLI command implementations (add, edit, delete, list, import, export, stats, batch, serve, help,
+ * version).
  * - Uses cn_* APIs (notes_io, db, display, utils, search)
  * - Portable getopt_long reset handling for GNU/BSD systems
  * - Memory-safe: bounds-checked copies, checked allocations, careful cleanup
@@ -15,9 +16,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 #include <getopt.h>
 #include <errno.h>
 #include <ctype.h>
+#include <unistd.h> /* dup */
 
 #include "cheatnote.h"
 #include "commands.h"
@@ -26,6 +29,16 @@
 #include "display.h"
 #include "utils.h"
 #include "search.h"
+#include "index.h"
+#include "scan.h"
+#include "csv.h"
+#include "export.h"
+#include "jsonl.h"
+#include "snapshot.h"
+#include "serve.h"
+#include "batch.h"
+#include "idmap.h"
+#include "tags.h"
 
 /* Helper: reset getopt between calls in a portable way */
 static void reset_getopt_state(void)
@@ -114,8 +127,8 @@ int cn_cmd_add(int argc, char *argv[])
         cn_error_exit("Failed to add note");
     }
 
-    /* Save db and report */
-    cn_db_save();
+    /* Persist (the id may move if another process added concurrently) */
+    id = cn_db_commit_note(id, CN_FIELD_ALL);
     printf("Note added successfully with ID: %s%u%s\n",
            use_colors ? COLOR_GREEN : "", id, use_colors ? COLOR_RESET : "");
     return 0;
@@ -214,7 +227,15 @@ int cn_cmd_edit(int argc, char *argv[])
 
     if (cn_note_edit(id, title, content, tags))
     {
-        cn_db_save();
+        /* the fields cn_note_edit replaced: empty title/content are ignored */
+        unsigned int fields = 0;
+        if (title && title[0] != '\0')
+            fields |= CN_FIELD_TITLE;
+        if (content && content[0] != '\0')
+            fields |= CN_FIELD_CONTENT;
+        if (tags)
+            fields |= CN_FIELD_TAGS;
+        cn_db_commit_note(id, fields);
         cn_success_msg("Note updated successfully");
         return 0;
     }
@@ -281,7 +302,7 @@ int cn_cmd_delete(int argc, char *argv[])
 
     if (cn_note_delete(id))
     {
-        cn_db_save();
+        cn_db_commit_delete(id);
         cn_success_msg("Note deleted successfully");
         return 0;
     }
@@ -298,6 +319,7 @@ int cn_cmd_list(int argc, char *argv[])
     cn_search_opts opts = {0};
     int compact = 0;
     int show_ids = 1;
+    int jobs = 0; /* 0 = size from the core count */
     int opt;
 
     struct option longopts[] = {
@@ -310,10 +332,11 @@ int cn_cmd_list(int argc, char *argv[])
         {"multiline", no_argument, NULL, 'm'},
         {"compact", no_argument, NULL, 'c'},
         {"no-ids", no_argument, NULL, 'n'},
+        {"jobs", required_argument, NULL, 'j'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}};
 
-    while ((opt = getopt_long(argc, argv, "s:g:riewmcnh", longopts, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "s:g:riewmcnj:h", longopts, NULL)) != -1)
     {
         switch (opt)
         {
@@ -344,6 +367,15 @@ int cn_cmd_list(int argc, char *argv[])
         case 'n':
             show_ids = 0;
             break;
+        case 'j':
+        {
+            char *endptr = NULL;
+            long v = strtol(optarg, &endptr, 10);
+            if (!endptr || *endptr != '\0' || v < 0 || v > INT_MAX)
+                cn_error_exit("Invalid --jobs value (use 0 for auto)");
+            jobs = (int)v;
+            break;
+        }
         case 'h':
             printf("Usage: cheatnote list [OPTIONS] [SEARCH_PATTERN]\n"
                    "Options:\n"
@@ -356,6 +388,7 @@ int cn_cmd_list(int argc, char *argv[])
                    "  -m, --multiline            Multiline regex mode\n"
                    "  -c, --compact              Compact output format\n"
                    "  -n, --no-ids               Hide note IDs\n"
+                   "  -j, --jobs N               Search threads (default: one per core)\n"
                    "  -h, --help                 Show this help\n\n"
                    "Positional usage:\n"
                    "  cheatnote list \"git status\"\n");
@@ -369,20 +402,34 @@ int cn_cmd_list(int argc, char *argv[])
     if (!opts.pattern && optind < argc)
         opts.pattern = argv[optind];
 
-    int found = 0;
+    /* Narrow the scan with the inverted index when the query allows it */
+    int indexed = cn_index_lookup(&opts);
+
+    /* Evaluate the query (possibly in parallel), then print in DB order */
+    unsigned char *hits = malloc(db.count ? db.count : 1);
+    if (!hits)
+        cn_error_exit("Failed to allocate memory for search");
+    long found = cn_scan_notes(&opts, indexed, jobs, hits);
+    cn_index_close();
+    if (found < 0)
+    {
+        free(hits);
+        cn_error_exit("Failed to allocate memory for search");
+        return 1;
+    }
 
     for (size_t i = 0; i < db.count; ++i)
     {
-        const cn_note *note = &db.notes[i];
-        if (cn_note_match_content(note, &opts) && cn_note_match_tags(note->tags, opts.tags))
-        {
-            if (compact)
-                cn_print_note_compact(note, show_ids);
-            else
-                cn_print_note_full(note, show_ids);
-            ++found;
-        }
+        if (!hits[i])
+            continue;
+        cn_note_view note;
+        cn_db_note_view(i, &note);
+        if (compact)
+            cn_print_note_compact(&note, show_ids);
+        else
+            cn_print_note_full(&note, show_ids);
     }
+    free(hits);
 
     if (found == 0)
     {
@@ -390,7 +437,7 @@ int cn_cmd_list(int argc, char *argv[])
     }
     else
     {
-        printf("%sFound %d note%s%s\n",
+        printf("%sFound %ld note%s%s\n",
                use_colors ? COLOR_GREEN : "", found, found == 1 ? "" : "s",
                use_colors ? COLOR_RESET : "");
     }
@@ -403,27 +450,73 @@ int cn_cmd_export(int argc, char *argv[])
     reset_getopt_state();
 
     char *filename = NULL;
+    int to_stdout = 0;
+    int jobs = 0;   /* 0 = size from the core count */
+    int shards = 0; /* 0 = one file */
+    const char *format_name = NULL;
+    int compress = 0;
     int opt;
 
     struct option longopts[] = {
         {"output", required_argument, NULL, 'o'},
+        {"format", required_argument, NULL, 'f'},
+        {"stdout", no_argument, NULL, 'S'},
+        {"compress", no_argument, NULL, 'z'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"shards", required_argument, NULL, 'N'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}};
 
-    while ((opt = getopt_long(argc, argv, "o:h", longopts, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "o:f:j:zh", longopts, NULL)) != -1)
     {
         switch (opt)
         {
         case 'o':
             filename = optarg;
             break;
+        case 'f':
+            format_name = optarg;
+            break;
+        case 'S':
+            to_stdout = 1;
+            break;
+        case 'z':
+            compress = 1;
+            break;
+        case 'j':
+        {
+            char *endptr = NULL;
+            long v = strtol(optarg, &endptr, 10);
+            if (!endptr || *endptr != '\0' || v < 0 || v > INT_MAX)
+                cn_error_exit("Invalid --jobs value (use 0 for auto)");
+            jobs = (int)v;
+            break;
+        }
+        case 'N':
+        {
+            char *endptr = NULL;
+            long v = strtol(optarg, &endptr, 10);
+            if (!endptr || *endptr != '\0' || v < 1 || v > 1000)
+                cn_error_exit("Invalid --shards value (use 1-1000)");
+            shards = (int)v;
+            break;
+        }
         case 'h':
             printf("Usage: cheatnote export [OPTIONS] [FILENAME]\n"
                    "Options:\n"
                    "  -o, --output FILENAME  Output filename\n"
+                   "  -f, --format FMT       csv, jsonl or bin (default: from the extension, else csv)\n"
+                   "  -z, --compress         LZ-compress a bin snapshot\n"
+                   "      --stdout           Write to standard output (also: FILENAME \"-\")\n"
+                   "  -j, --jobs N           Formatting threads (default: one per core)\n"
+                   "      --shards N         Write N files FILENAME-000 ... each with a header\n"
                    "  -h, --help             Show this help\n\n"
                    "Positional usage:\n"
-                   "  cheatnote export my_notes.csv\n");
+                   "  cheatnote export my_notes.csv\n"
+                   "  cheatnote export --stdout | gzip > notes.csv.gz\n"
+                   "  cheatnote export notes.jsonl\n"
+                   "  cheatnote export -f bin -z backup.cnb\n"
+                   "  cheatnote export --shards 4 backup.csv   (backup-000.csv ... backup-003.csv)\n");
             return 0;
         default:
             cn_error_exit("Invalid option for export command");
@@ -432,131 +525,272 @@ int cn_cmd_export(int argc, char *argv[])
 
     if (!filename && optind < argc)
         filename = argv[optind];
-    if (!filename)
+    if (filename && strcmp(filename, "-") == 0)
+        to_stdout = 1;
+    if (!filename && !to_stdout)
     {
         filename = "cheatnotes_export.csv";
         cn_info_msg("No filename specified, using default: cheatnotes_export.csv");
     }
 
-    FILE *f = fopen(filename, "w");
+    cn_export_format format = cn_export_format_guess(to_stdout ? NULL : filename);
+    if (format_name && !cn_export_format_parse(format_name, &format))
+        cn_error_exit("Unknown export format (use csv, jsonl or bin)");
+    if (compress && format != CN_EXPORT_BIN)
+        cn_error_exit("--compress applies to --format=bin only");
+    const char *format_label = cn_export_format_name(format);
+
+    if (shards > 0)
+    {
+        if (to_stdout)
+            cn_error_exit("--shards cannot be combined with --stdout");
+        if (format == CN_EXPORT_BIN)
+            cn_error_exit("--shards supports csv and jsonl only");
+        if (!cn_export_shards(filename, format, shards, jobs))
+            cn_error_exit("Failed to write export shards");
+
+        char first[PATH_MAX], last[PATH_MAX];
+        cn_export_shard_path(filename, 0, first, sizeof(first));
+        cn_export_shard_path(filename, shards - 1, last, sizeof(last));
+        printf("Exported %zu notes to %d shards %s%s%s .. %s%s%s in %s format\n", db.count, shards,
+               use_colors ? COLOR_CYAN : "", first, use_colors ? COLOR_RESET : "",
+               use_colors ? COLOR_CYAN : "", last, use_colors ? COLOR_RESET : "", format_label);
+        return 0;
+    }
+
+    if (to_stdout)
+    {
+        /* Keep stdout pure data: the summary goes to stderr */
+        int ok = format == CN_EXPORT_BIN ? cn_snapshot_write(stdout, compress)
+                                         : cn_export_notes(stdout, format, jobs);
+        if (!ok)
+            cn_error_exit("Write error");
+        fprintf(stderr, "Exported %zu notes to standard output in %s format\n", db.count, format_label);
+        return 0;
+    }
+
+    FILE *f = fopen(filename, format == CN_EXPORT_BIN ? "wb" : "w");
     if (!f)
     {
         cn_error_exit("Failed to open export file for writing");
     }
 
-    if (fprintf(f, "ID,Title,Content,Tags,Created,Modified\n") < 0)
+    int ok = format == CN_EXPORT_BIN ? cn_snapshot_write(f, compress) : cn_export_notes(f, format, jobs);
+    if (!ok)
     {
         fclose(f);
-        cn_error_exit("Failed to write export header");
+        cn_error_exit("Write error");
     }
 
-    for (size_t i = 0; i < db.count; ++i)
+    if (fclose(f) != 0)
+        cn_error_exit("Failed to close export file");
+
+    printf("Exported %zu notes to %s%s%s in %s format\n",
+           db.count, use_colors ? COLOR_CYAN : "", filename, use_colors ? COLOR_RESET : "", format_label);
+    return 0;
+}
+
+/* ---------- import ---------- */
+
+/* Add one imported record. Over-long fields are truncated, as with the old
+ * fixed field buffers. Returns the new note's id; otherwise warns and
+ * returns 0. */
+static unsigned int import_one(char *title, size_t title_len, char *content, size_t content_len,
+                      char *tags, size_t tags_len, size_t line_num)
+{
+    if (title_len >= MAX_TITLE_LEN)
+        title[MAX_TITLE_LEN - 1] = '\0';
+    if (content_len >= MAX_CONTENT_LEN)
+        content[MAX_CONTENT_LEN - 1] = '\0';
+    if (tags_len >= MAX_TAGS_LEN)
+        tags[MAX_TAGS_LEN - 1] = '\0';
+
+    if (title[0] == '\0' || content[0] == '\0')
     {
-        const cn_note *note = &db.notes[i];
+        fprintf(stderr, "%sWarning:%s Skipping line %zu - missing title or content\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
+        return 0;
+    }
 
-        if (fprintf(f, "%u,\"", note->id) < 0)
-        {
-            fclose(f);
-            cn_error_exit("Write error");
-        }
+    unsigned int nid = cn_note_add(title, content, tags[0] ? tags : NULL);
+    if (nid == 0)
+    {
+        fprintf(stderr, "%sWarning:%s Failed to import line %zu\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
+        return 0;
+    }
+    return nid;
+}
 
-        /* escape and write title */
-        for (const char *p = note->title; *p; ++p)
+/* Give the note just imported as `nid` the timestamps recorded in the
+ * object and, when replacing the database, its original id if still free */
+static void keep_jsonl_metadata(unsigned int nid, const cn_jsonl_note *src, int merge_mode)
+{
+    size_t slot = cn_idmap_find(nid);
+    if (slot == SIZE_MAX)
+        return;
+
+    if (src->created > 0)
+        db.created_at[slot] = (time_t)src->created;
+    if (src->modified > 0)
+        db.modified_at[slot] = (time_t)src->modified;
+
+    if (merge_mode || src->id <= 0 || src->id >= UINT_MAX || (unsigned int)src->id == nid ||
+        cn_idmap_find((unsigned int)src->id) != SIZE_MAX)
+        return;
+    unsigned int id = (unsigned int)src->id;
+    cn_tags_forget(slot);
+    cn_idmap_remove(nid);
+    db.ids[slot] = id;
+    cn_idmap_set(id, slot);
+    cn_tags_index(slot);
+    if (id >= db.next_id)
+        db.next_id = id + 1;
+}
+
+static void import_csv(FILE *f, size_t *imported, size_t *errors)
+{
+    /* Records are parsed in place inside the reader's block buffer; the
+     * longest accepted record matches the old line buffer. */
+    cn_csv_reader reader;
+    if (!cn_csv_open(&reader, f, MAX_LINE_LENGTH - 2))
+    {
+        fclose(f);
+        cn_error_exit("Failed to allocate memory for line buffer");
+    }
+
+    /* One allocation for the whole batch instead of repeated doubling */
+    if (!cn_note_reserve(cn_csv_estimate_records(&reader)))
+        cn_info_msg("Could not pre-allocate for import; growing as needed");
+
+    cn_csv_field fields[4];
+    size_t nfields = 0;
+    int rc;
+
+    while ((rc = cn_csv_next(&reader, fields, 4, &nfields)) != CN_CSV_END)
+    {
+        size_t line_num = reader.line;
+        if (rc == CN_CSV_OVERLONG)
         {
-            if (*p == '"')
-            {
-                if (fputs("\"\"", f) == EOF)
-                {
-                    fclose(f);
-                    cn_error_exit("Write error");
-                }
-            }
-            else if (fputc((unsigned char)*p, f) == EOF)
-            {
-                fclose(f);
-                cn_error_exit("Write error");
-            }
+            fprintf(stderr, "%sWarning:%s Skipping overlong line %zu\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
+            ++*errors;
+            continue;
         }
+        if (nfields == 0)
+            continue; /* blank line */
+
+        /* skip header */
+        if (line_num == 1 && nfields >= 3 &&
+            ((strcmp(fields[0].ptr, "ID") == 0 && strcmp(fields[1].ptr, "Title") == 0 &&
+              strcmp(fields[2].ptr, "Content") == 0) ||
+             (strcmp(fields[0].ptr, "id") == 0 && strcmp(fields[1].ptr, "title") == 0 &&
+              strcmp(fields[2].ptr, "content") == 0)))
+            continue;
 
-        if (fputs("\",\"", f) == EOF)
+        if (import_one(fields[1].ptr, fields[1].len, fields[2].ptr, fields[2].len,
+                       fields[3].ptr, fields[3].len, line_num))
+            ++*imported;
+        else
+            ++*errors;
+    }
+
+    cn_csv_close(&reader);
+}
+
+static void import_jsonl(FILE *f, int merge_mode, size_t *imported, size_t *errors)
+{
+    /* Escapes make a JSON line longer than the same note in CSV */
+    cn_jsonl_reader reader;
+    if (!cn_jsonl_open(&reader, f, 2 * MAX_LINE_LENGTH))
+    {
+        fclose(f);
+        cn_error_exit("Failed to allocate memory for line buffer");
+    }
+
+    if (!cn_note_reserve(cn_jsonl_estimate_records(&reader)))
+        cn_info_msg("Could not pre-allocate for import; growing as needed");
+
+    cn_jsonl_note note;
+    int rc;
+
+    while ((rc = cn_jsonl_next(&reader, &note)) != CN_JSONL_END)
+    {
+        size_t line_num = reader.line;
+        if (rc == CN_JSONL_OVERLONG || rc == CN_JSONL_INVALID)
         {
-            fclose(f);
-            cn_error_exit("Write error");
+            fprintf(stderr, "%sWarning:%s Skipping %s line %zu\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "",
+                    rc == CN_JSONL_OVERLONG ? "overlong" : "invalid JSON", line_num);
+            ++*errors;
+            continue;
         }
 
-        /* escape and write content */
-        for (const char *p = note->content; *p; ++p)
+        unsigned int nid = import_one(note.title, note.title_len, note.content, note.content_len,
+                                      note.tags, note.tags_len, line_num);
+        if (nid)
         {
-            if (*p == '"')
-            {
-                if (fputs("\"\"", f) == EOF)
-                {
-                    fclose(f);
-                    cn_error_exit("Write error");
-                }
-            }
-            else if (fputc((unsigned char)*p, f) == EOF)
-            {
-                fclose(f);
-                cn_error_exit("Write error");
-            }
+            keep_jsonl_metadata(nid, &note, merge_mode);
+            ++*imported;
         }
-
-        if (fputs("\",\"", f) == EOF)
+        else
         {
-            fclose(f);
-            cn_error_exit("Write error");
+            ++*errors;
         }
+    }
+
+    cn_jsonl_close(&reader);
+}
 
-        /* escape and write tags */
-        for (const char *p = note->tags; *p; ++p)
+/* Restore a snapshot: ids and timestamps are kept unless merging, where
+ * notes get new ids like any other import */
+static void import_bin(FILE *f, int merge_mode, size_t *imported, size_t *errors)
+{
+    cn_snapshot snap;
+    const char *err = NULL;
+    if (!cn_snapshot_read(f, &snap, &err))
+    {
+        fclose(f);
+        cn_error_exit(err);
+    }
+
+    if (!cn_note_reserve(snap.count))
+        cn_info_msg("Could not pre-allocate for import; growing as needed");
+
+    cn_note_view note;
+    while (cn_snapshot_next(&snap, &note))
+    {
+        int ok = merge_mode ? cn_note_add(note.title, note.content, note.tags_len ? note.tags : NULL) != 0
+                            : cn_note_put(&note);
+        if (ok)
         {
-            if (*p == '"')
-            {
-                if (fputs("\"\"", f) == EOF)
-                {
-                    fclose(f);
-                    cn_error_exit("Write error");
-                }
-            }
-            else if (fputc((unsigned char)*p, f) == EOF)
-            {
-                fclose(f);
-                cn_error_exit("Write error");
-            }
+            ++*imported;
         }
-
-        if (fprintf(f, "\",%ld,%ld\n", (long)note->created_at, (long)note->modified_at) < 0)
+        else
         {
-            fclose(f);
-            cn_error_exit("Write error");
+            fprintf(stderr, "%sWarning:%s Failed to import note %u\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", note.id);
+            ++*errors;
         }
     }
+    if (!merge_mode && snap.next_id > db.next_id)
+        db.next_id = snap.next_id;
 
-    if (fclose(f) != 0)
-        cn_error_exit("Failed to close export file");
-
-    printf("Exported %zu notes to %s%s%s in CSV format\n",
-           db.count, use_colors ? COLOR_CYAN : "", filename, use_colors ? COLOR_RESET : "");
-    return 0;
+    cn_snapshot_free(&snap);
 }
 
-/* ---------- import ---------- */
 int cn_cmd_import(int argc, char *argv[])
 {
     reset_getopt_state();
 
     char *filename = NULL;
     int merge_mode = 0;
+    const char *format_name = NULL;
     int opt;
 
     struct option longopts[] = {
         {"input", required_argument, NULL, 'i'},
         {"merge", no_argument, NULL, 'm'},
+        {"format", required_argument, NULL, 'f'},
         {"help", no_argument, NULL, 'h'},
         {NULL, 0, NULL, 0}};
 
-    while ((opt = getopt_long(argc, argv, "i:mh", longopts, NULL)) != -1)
+    while ((opt = getopt_long(argc, argv, "i:mf:h", longopts, NULL)) != -1)
     {
         switch (opt)
         {
@@ -566,14 +800,20 @@ int cn_cmd_import(int argc, char *argv[])
         case 'm':
             merge_mode = 1;
             break;
+        case 'f':
+            format_name = optarg;
+            break;
         case 'h':
             printf("Usage: cheatnote import [OPTIONS] [FILENAME]\n"
                    "Options:\n"
                    "  -i, --input FILENAME  Input filename\n"
                    "  -m, --merge           Merge with existing notes (default: replace)\n"
+                   "  -f, --format FMT      csv, jsonl or bin (default: from the extension or content)\n"
                    "  -h, --help            Show this help\n\n"
                    "Positional usage:\n"
-                   "  cheatnote import my_notes.csv\n");
+                   "  cheatnote import my_notes.csv\n"
+                   "  cheatnote import my_notes.jsonl\n"
+                   "  cheatnote import backup.cnb\n");
             return 0;
         default:
             cn_error_exit("Invalid option for import command");
@@ -585,85 +825,42 @@ int cn_cmd_import(int argc, char *argv[])
     if (!filename)
         cn_error_exit("Input filename is required for import command");
 
-    FILE *f = fopen(filename, "r");
+    cn_export_format format = cn_export_format_guess(filename);
+    if (format_name && !cn_export_format_parse(format_name, &format))
+        cn_error_exit("Unknown import format (use csv, jsonl or bin)");
+
+    FILE *f = fopen(filename, "rb");
     if (!f)
         cn_error_exit("Failed to open import file for reading");
 
-    if (!merge_mode)
+    /* No explicit format: a snapshot header, or a JSON object first */
+    if (!format_name && cn_snapshot_detect(f))
     {
-        cn_db_cleanup();
-        cn_db_init();
+        format = CN_EXPORT_BIN;
     }
-
-    size_t imported = 0, line_num = 0, errors = 0;
-    char *linebuf = malloc(MAX_LINE_LENGTH);
-    if (!linebuf)
+    else if (!format_name && format == CN_EXPORT_CSV)
     {
-        fclose(f);
-        cn_error_exit("Failed to allocate memory for line buffer");
+        int c = getc(f);
+        if (c == '{')
+            format = CN_EXPORT_JSONL;
+        if (c != EOF)
+            ungetc(c, f);
     }
 
-    while (fgets(linebuf, MAX_LINE_LENGTH, f))
+    if (!merge_mode)
     {
-        ++line_num;
-
-        size_t len = strlen(linebuf);
-        if (len == MAX_LINE_LENGTH - 1 && linebuf[len - 1] != '\n' && !feof(f))
-        {
-            /* skip remainder of overlong line */
-            int ch;
-            while ((ch = fgetc(f)) != '\n' && ch != EOF)
-            {
-            }
-            fprintf(stderr, "%sWarning:%s Skipping overlong line %zu\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
-            ++errors;
-            continue;
-        }
-
-        /* skip header */
-        if (line_num == 1 && (strstr(linebuf, "ID,Title,Content") || strstr(linebuf, "id,title,content")))
-            continue;
-
-        if (len > 0 && linebuf[len - 1] == '\n')
-            linebuf[len - 1] = '\0';
-        if (linebuf[0] == '\0')
-            continue;
-
-        char *pos = linebuf;
-        char id_str[32] = {0};
-        char title[MAX_TITLE_LEN] = {0};
-        char content[MAX_CONTENT_LEN] = {0};
-        char tags[MAX_TAGS_LEN] = {0};
-
-        if (!cn_parse_csv_field(&pos, id_str, sizeof(id_str)) ||
-            !cn_parse_csv_field(&pos, title, sizeof(title)) ||
-            !cn_parse_csv_field(&pos, content, sizeof(content)))
-        {
-            fprintf(stderr, "%sWarning:%s Skipping malformed line %zu\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
-            ++errors;
-            continue;
-        }
-        /* optional tags */
-        cn_parse_csv_field(&pos, tags, sizeof(tags));
-
-        if (title[0] == '\0' || content[0] == '\0')
-        {
-            fprintf(stderr, "%sWarning:%s Skipping line %zu - missing title or content\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
-            ++errors;
-            continue;
-        }
-
-        unsigned int nid = cn_note_add(title, content, tags[0] ? tags : NULL);
-        if (nid == 0)
-        {
-            fprintf(stderr, "%sWarning:%s Failed to import line %zu\n", use_colors ? COLOR_YELLOW : "", use_colors ? COLOR_RESET : "", line_num);
-            ++errors;
-            continue;
-        }
-        ++imported;
+        cn_db_cleanup();
+        cn_db_init();
     }
 
-    free(linebuf);
+    size_t imported = 0, errors = 0;
+    if (format == CN_EXPORT_BIN)
+        import_bin(f, merge_mode, &imported, &errors);
+    else if (format == CN_EXPORT_JSONL)
+        import_jsonl(f, merge_mode, &imported, &errors);
+    else
+        import_csv(f, &imported, &errors);
+
     if (fclose(f) != 0)
         fprintf(stderr, "Warning: Error closing import file\n");
 
@@ -692,25 +889,27 @@ int cn_cmd_stats(int argc, char *argv[])
 
     size_t total_chars = 0;
     size_t total_lines = 0;
-    time_t oldest = db.notes[0].created_at;
-    time_t newest = db.notes[0].created_at;
+    cn_note_view note;
+    cn_db_note_view(0, &note);
+    time_t oldest = note.created_at;
+    time_t newest = note.created_at;
 
     for (size_t i = 0; i < db.count; ++i)
     {
-        const cn_note *note = &db.notes[i];
-        total_chars += strlen(note->content);
+        cn_db_note_view(i, &note);
+        total_chars += note.content_len;
 
         /* count lines */
-        for (const char *p = note->content; *p; ++p)
-            if (*p == '\n')
-                ++total_lines;
-        if (note->content[0])
+        const char *end = note.content + note.content_len;
+        for (const char *p = note.content; (p = memchr(p, '\n', (size_t)(end - p))) != NULL; ++p)
+            ++total_lines;
+        if (note.content_len)
             ++total_lines; /* last line */
 
-        if (note->created_at < oldest)
-            oldest = note->created_at;
-        if (note->created_at > newest)
-            newest = note->created_at;
+        if (note.created_at < oldest)
+            oldest = note.created_at;
+        if (note.created_at > newest)
+            newest = note.created_at;
     }
 
     char oldest_str[32] = "Invalid date", newest_str[32] = "Invalid date";
@@ -735,11 +934,114 @@ int cn_cmd_stats(int argc, char *argv[])
     printf("Oldest Note:     %s%s%s\n", use_colors ? COLOR_DIM : "", oldest_str, use_colors ? COLOR_RESET : "");
     printf("Newest Note:     %s%s%s\n", use_colors ? COLOR_DIM : "", newest_str, use_colors ? COLOR_RESET : "");
     printf("Database Size:   %s%.2f KB%s\n", use_colors ? COLOR_CYAN : "",
-           (double)(sizeof(cn_note) * db.count) / 1024.0, use_colors ? COLOR_RESET : "");
+           (double)cn_db_file_size() / 1024.0, use_colors ? COLOR_RESET : "");
 
     return 0;
 }
 
+/* ---------- batch ---------- */
+int cn_cmd_batch(int argc, char *argv[])
+{
+    reset_getopt_state();
+
+    const char *filename = NULL;
+    size_t checkpoint = 0;
+    int opt;
+
+    struct option longopts[] = {
+        {"file", required_argument, NULL, 'f'},
+        {"checkpoint", required_argument, NULL, 'k'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+
+    while ((opt = getopt_long(argc, argv, "f:k:h", longopts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            filename = optarg;
+            break;
+        case 'k':
+        {
+            char *endptr = NULL;
+            long v = strtol(optarg, &endptr, 10);
+            if (endptr == NULL || *endptr != '\0' || v < 0)
+                cn_error_exit("Invalid --checkpoint value (use 0 to save only at the end)");
+            checkpoint = (size_t)v;
+            break;
+        }
+        case 'h':
+            printf("Usage: cheatnote batch [OPTIONS] [FILENAME]\n"
+                   "Run one command per line (add, edit, delete, list, stats) from\n"
+                   "FILENAME or standard input, saving the database once at the end.\n"
+                   "Options:\n"
+                   "  -f, --file FILENAME   Read commands from FILENAME ('-' for stdin)\n"
+                   "  -k, --checkpoint N    Also save after every N changes (default: 0)\n"
+                   "  -h, --help            Show this help\n\n"
+                   "Example input:\n"
+                   "  add \"Git status\" \"git status -s\" git\n"
+                   "  edit 5 -g \"git,vcs\"\n"
+                   "  delete 7\n");
+            return 0;
+        default:
+            cn_error_exit("Invalid option for batch command");
+        }
+    }
+
+    if (!filename && optind < argc)
+        filename = argv[optind];
+
+    /* A private stream over stdin: buffered input must not outlive the
+     * batch (the daemon reuses this process for other clients) */
+    FILE *in;
+    if (!filename || strcmp(filename, "-") == 0)
+    {
+        int fd = dup(fileno(stdin));
+        in = fd >= 0 ? fdopen(fd, "r") : NULL;
+        filename = "stdin";
+    }
+    else
+    {
+        in = fopen(filename, "r");
+    }
+    if (!in)
+        cn_error_exit("Failed to open batch input for reading");
+
+    int rc = cn_batch_run(in, filename, checkpoint);
+    fclose(in);
+    return rc;
+}
+
+/* ---------- serve ---------- */
+int cn_cmd_serve(int argc, char *argv[])
+{
+    reset_getopt_state();
+
+    int opt;
+    struct option longopts[] = {
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+
+    while ((opt = getopt_long(argc, argv, "h", longopts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'h':
+            printf("Usage: cheatnote serve\n"
+                   "Keep the database in memory and run the commands of other\n"
+                   "cheatnote invocations on it (socket: <db>.sock). Runs in the\n"
+                   "foreground until interrupted; use --no-daemon to bypass it.\n"
+                   "Options:\n"
+                   "  -h, --help   Show this help\n");
+            return 0;
+        default:
+            cn_error_exit("Invalid option for serve command");
+        }
+    }
+
+    return cn_serve_run();
+}
+
 /* ---------- help & version & dispatch ---------- */
 int cn_cmd_help(int argc, char *argv[])
 {
@@ -757,10 +1059,13 @@ int cn_cmd_help(int argc, char *argv[])
     printf("  export   Export notes to file\n");
     printf("  import   Import notes from file\n");
     printf("  stats    Show database statistics\n");
+    printf("  batch    Run many commands with a single save\n");
+    printf("  serve    Keep the database in memory for other invocations\n");
     printf("  help     Show this help message\n");
     printf("  version  Show version information\n\n");
     printf("Global Options:\n");
     printf("  --no-color   Disable colored output\n");
+    printf("  --no-daemon  Run locally even if `cheatnote serve` is running\n");
     printf("  CHEATNOTE_DB   Override database path\n\n");
     printf("Examples:\n");
     printf("  cheatnote add \"Git status\" \"git status -s\" \"git,status\"\n");
@@ -779,6 +1084,24 @@ int cn_cmd_version(int argc, char *argv[])
     return 0;
 }
 
+/* Commands that never modify the database; main() opens the DB for them
+ * with cn_db_open_readonly() instead of a full heap load. */
+int cn_command_is_readonly(const char *cmd)
+{
+    if (!cmd)
+        return 1; /* no command: help only */
+    return strcmp(cmd, "list") == 0 || strcmp(cmd, "stats") == 0 ||
+           strcmp(cmd, "export") == 0 || strcmp(cmd, "help") == 0 ||
+           strcmp(cmd, "version") == 0;
+}
+
+/* Commands that rewrite the whole database from a loaded copy: they hold
+ * the exclusive lock from load to save so no concurrent commit is lost */
+int cn_command_rewrites_db(const char *cmd)
+{
+    return cmd && (strcmp(cmd, "import") == 0 || strcmp(cmd, "batch") == 0);
+}
+
 int cn_commands_dispatch(int argc, char *argv[])
 {
     if (argc < 2)
@@ -813,6 +1136,10 @@ int cn_commands_dispatch(int argc, char *argv[])
         return cn_cmd_import(argc - 1, argv + 1);
     if (strcmp(cmd, "stats") == 0)
         return cn_cmd_stats(argc - 1, argv + 1);
+    if (strcmp(cmd, "batch") == 0)
+        return cn_cmd_batch(argc - 1, argv + 1);
+    if (strcmp(cmd, "serve") == 0)
+        return cn_cmd_serve(argc - 1, argv + 1);
 
     fprintf(stderr, "Unknown command: %s\n", cmd);
     fprintf(stderr, "Use 'cheatnote help' for usage information\n");
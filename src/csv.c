@@ -0,0 +1,311 @@
+/*
+ * src/csv.c
+ *
+ * Streaming RFC 4180 CSV reader used by `import`.
+ *
+ * - The file is read in CN_CSV_BLOCK_SIZE chunks into one buffer. A small
+ *   state machine (field start / unquoted / quoted / quote-in-quoted /
+ *   after closing quote) finds where each record ends: a newline ends the
+ *   record unless it is inside a quoted field, so multi-line notes written
+ *   by `export` come back as one record. The scanner's state is kept in the
+ *   reader, so a record split across blocks (even between the two quotes of
+ *   a "" escape) is resumed, never rescanned.
+ * - Records are parsed where they lie: quotes are removed and "" escapes
+ *   collapsed by compacting each field in place, and every field is
+ *   NUL-terminated inside the buffer. Nothing is copied per field.
+ * - A partial record at the end of a block is moved to the front of the
+ *   buffer before the next read, so at most one record is ever memmoved.
+ * - CRLF record terminators are accepted; CR/LF inside quotes is kept.
+ * - Leniencies kept from the old line parser: leading whitespace before a
+ *   field is skipped and text between a closing quote and the next comma
+ *   is dropped. A record longer than max_record (e.g. a stray quote that
+ *   never closes) is reported and skipped up to the next newline; a quote
+ *   still open at end of input ends its record at the first newline.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "csv.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int cn_csv_open(cn_csv_reader *r, FILE *f, size_t max_record)
+{
+    memset(r, 0, sizeof(*r));
+    r->f = f;
+    r->max_record = max_record;
+    r->next_line = 1;
+    r->state = CN_CSV_S_START;
+    /* Room for a full block after the largest partial record, plus a NUL */
+    r->cap = CN_CSV_BLOCK_SIZE + max_record + 2;
+    r->buf = malloc(r->cap);
+    return r->buf != NULL;
+}
+
+void cn_csv_close(cn_csv_reader *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+    r->start = r->end = r->cap = 0;
+}
+
+/* Move the unconsumed tail to the front and read another block.
+ * Returns the number of bytes read (0 at end of file or on error). */
+static size_t refill(cn_csv_reader *r)
+{
+    if (r->eof)
+        return 0;
+    if (r->start > 0)
+    {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->scan -= r->start;
+        r->start = 0;
+    }
+    size_t n = fread(r->buf + r->end, 1, r->cap - 1 - r->end, r->f);
+    if (n == 0)
+        r->eof = 1;
+    r->end += n;
+    return n;
+}
+
+/* Drop input up to and including the next newline (overlong record) */
+static void skip_line(cn_csv_reader *r)
+{
+    for (;;)
+    {
+        char *nl = memchr(r->buf + r->start, '\n', r->end - r->start);
+        if (nl)
+        {
+            r->start = (size_t)(nl - r->buf) + 1;
+            r->next_line++;
+            break;
+        }
+        r->start = r->end = 0;
+        if (refill(r) == 0)
+            break;
+    }
+    r->scan = r->start;
+    r->state = CN_CSV_S_START;
+    r->rec_lines = 0;
+}
+
+/* Advance the record scanner over buffered bytes. Returns 1 with r->scan on
+ * the newline that ends the record, 0 if more input is needed. A newline
+ * ends the record unless it lies inside a quoted field. */
+static int scan_record(cn_csv_reader *r)
+{
+    const char *buf = r->buf;
+    size_t i = r->scan, end = r->end;
+    int st = r->state;
+
+    while (i < end)
+    {
+        if (st == CN_CSV_S_QUOTED)
+        {
+            /* Only a quote can leave a quoted field: jump straight to it,
+             * counting the embedded newlines on the way */
+            const char *q = memchr(buf + i, '"', end - i);
+            size_t stop = q ? (size_t)(q - buf) : end;
+            for (const char *p = buf + i; (p = memchr(p, '\n', (size_t)(buf + stop - p))) != NULL; ++p)
+                r->rec_lines++;
+            i = stop;
+            if (!q)
+                break;
+            st = CN_CSV_S_QUOTE_IN_QUOTED;
+            ++i;
+            continue;
+        }
+
+        char c = buf[i];
+        if (c == '\n')
+        {
+            r->scan = i;
+            r->state = st;
+            return 1;
+        }
+        switch (st)
+        {
+        case CN_CSV_S_START:
+            if (c == '"')
+                st = CN_CSV_S_QUOTED;
+            else if (c != ',' && !isspace((unsigned char)c))
+                st = CN_CSV_S_UNQUOTED;
+            break;
+        case CN_CSV_S_QUOTE_IN_QUOTED:
+            if (c == '"')
+                st = CN_CSV_S_QUOTED; /* "" escape */
+            else
+                st = c == ',' ? CN_CSV_S_START : CN_CSV_S_AFTER_QUOTED;
+            break;
+        default: /* unquoted field, or junk after a closing quote */
+            if (c == ',')
+                st = CN_CSV_S_START;
+            break;
+        }
+        ++i;
+    }
+
+    r->scan = i;
+    r->state = st;
+    return 0;
+}
+
+/* Split the NUL-terminated record at p into fields, in place */
+static size_t split_fields(char *p, cn_csv_field *fields, size_t max_fields)
+{
+    size_t present = *p ? 1 : 0;
+    for (size_t i = 0; i < max_fields; ++i)
+    {
+        while (*p && isspace((unsigned char)*p))
+            ++p;
+
+        if (*p == '"')
+        {
+            char *w = ++p;
+            fields[i].ptr = w;
+            while (*p)
+            {
+                if (*p == '"')
+                {
+                    if (p[1] != '"')
+                    {
+                        ++p; /* closing quote */
+                        break;
+                    }
+                    ++p; /* escaped quote: keep one */
+                }
+                *w++ = *p++;
+            }
+            fields[i].len = (size_t)(w - fields[i].ptr);
+
+            /* Ignore anything between the closing quote and the comma */
+            while (*p && *p != ',')
+                ++p;
+            if (*p == ',')
+            {
+                ++p;
+                ++present;
+            }
+            *w = '\0';
+        }
+        else
+        {
+            fields[i].ptr = p;
+            while (*p && *p != ',')
+                ++p;
+            fields[i].len = (size_t)(p - fields[i].ptr);
+            if (*p == ',')
+            {
+                *p++ = '\0';
+                ++present;
+            }
+        }
+    }
+    return present < max_fields ? present : max_fields;
+}
+
+int cn_csv_next(cn_csv_reader *r, cn_csv_field *fields, size_t max_fields, size_t *nfields)
+{
+    for (;;)
+    {
+        size_t len;
+        int found = scan_record(r);
+        char *rec = r->buf + r->start;
+
+        if (found)
+        {
+            len = r->scan - r->start;
+            r->start = r->scan + 1;
+        }
+        else if (r->scan - r->start > r->max_record)
+        {
+            /* Too long, or a stray quote ran away: resync after the first
+             * newline of the record, as a line-based reader would */
+            r->line = r->next_line;
+            char *nl = memchr(rec, '\n', r->scan - r->start);
+            if (nl)
+            {
+                r->start = (size_t)(nl - r->buf) + 1;
+                r->next_line++;
+                r->scan = r->start;
+                r->state = CN_CSV_S_START;
+                r->rec_lines = 0;
+            }
+            else
+            {
+                r->start = r->scan;
+                skip_line(r);
+            }
+            return CN_CSV_OVERLONG;
+        }
+        else if (!r->eof && refill(r) > 0)
+        {
+            continue;
+        }
+        else if (r->end == r->start)
+        {
+            return CN_CSV_END;
+        }
+        else
+        {
+            /* Last record without a trailing newline */
+            rec = r->buf + r->start;
+            len = r->end - r->start;
+            r->start = r->end;
+
+            /* A stray quote that never closes would swallow every later
+             * row: take only its first line, as a line-based reader would,
+             * and resync after it */
+            char *nl = r->state == CN_CSV_S_QUOTED ? memchr(rec, '\n', len) : NULL;
+            if (nl)
+            {
+                len = (size_t)(nl - rec);
+                r->start = (size_t)(nl - r->buf) + 1;
+                r->rec_lines = 0;
+            }
+        }
+
+        r->line = r->next_line;
+        r->next_line += r->rec_lines + 1;
+        r->rec_lines = 0;
+        r->scan = r->start;
+        r->state = CN_CSV_S_START;
+
+        if (len > r->max_record)
+            return CN_CSV_OVERLONG;
+
+        /* CRLF line endings: the CR belongs to the terminator */
+        if (len > 0 && rec[len - 1] == '\r')
+            --len;
+
+        rec[len] = '\0';
+        size_t n = split_fields(rec, fields, max_fields);
+        if (nfields)
+            *nfields = n;
+        return CN_CSV_RECORD;
+    }
+}
+
+size_t cn_csv_estimate_records(cn_csv_reader *r)
+{
+    if (r->end == r->start)
+        refill(r);
+
+    size_t buffered = r->end - r->start, lines = 0;
+    for (const char *p = r->buf + r->start, *e = r->buf + r->end;
+         (p = memchr(p, '\n', (size_t)(e - p))) != NULL; ++p)
+        ++lines;
+    if (buffered == 0)
+        return 0;
+
+    struct stat st;
+    if (r->eof || fstat(fileno(r->f), &st) != 0 || (size_t)st.st_size <= buffered)
+        return lines + 1;
+    return (size_t)((double)lines * (double)st.st_size / (double)buffered) + 1;
+}
@@ -5,13 +5,23 @@
  *
  * Responsibilities:
  *  - Provide cn_db_init/cn_db_load/cn_db_save/cn_db_cleanup
+ *  - Provide cn_db_open_readonly (mmap, zero-copy) and cn_db_note_view
+ *  - Journal add/edit/delete (cn_db_commit_*) and compact into the base file
  *  - Provide cn_get_db_path / cn_set_db_path (portable, XDG-aware)
  *  - Ensure parent directories exist (recursive mkdir)
  *
  * Safety & portability:
  *  - Bounds-checked path building
  *  - Check return values for all allocations / IO
- *  - Use atomic rename for database updates
+ *  - Use atomic rename for database updates (uniquely named temp files),
+ *    synced along with their directory before the journal is dropped
+ *  - Coordinate processes through the advisory lock in lock.c: loads and
+ *    read-only opens hold it shared, commits exclusive. A commit first
+ *    checks whether another process changed the files since this one
+ *    loaded them and, if so, reloads and re-applies its change (a new note
+ *    gets a fresh id) instead of overwriting theirs.
+ *  - Variable-length record format; legacy fixed-size files are migrated
+ *    by the first commit (never by a load, which may hold the lock shared)
  *
  * Globals:
  *  - Uses extern `db`, `use_colors`, `db_path` declared in cheatnote.h and defined in main.c
@@ -28,6 +38,12 @@
 #include "db.h"
 #include "utils.h"
 #include "display.h"
+#include "journal.h"
+#include "notes_io.h"
+#include "arena.h"
+#include "idmap.h"
+#include "tags.h"
+#include "lock.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,10 +54,13 @@
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <direct.h>
+#include <io.h>
 #define mkdir_p(path, mode) _mkdir(path)
 #define PATH_SEP '\\'
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #define PATH_SEP '/'
 #endif
 
@@ -50,6 +69,7 @@ extern int use_colors;
 extern char db_path[PATH_MAX];
 
 /* Internal helpers forward */
+static void open_readonly_locked(void);
 static int make_parent_dirs(const char *path);
 static const char *build_default_db_path(char *outbuf, size_t bufsz);
 static int path_dirname(const char *path, char *outdir, size_t outdir_sz);
@@ -61,17 +81,95 @@ static int path_dirname(const char *path, char *outdir, size_t outdir_sz);
 /* Ensure DB structure is allocated (empty) */
 void cn_db_init(void)
 {
-    if (db.notes)
+    if (db.ids)
         return;
 
-    db.capacity = INITIAL_CAPACITY;
-    db.notes = calloc(db.capacity, sizeof(cn_note));
-    if (!db.notes)
+    if (!cn_db_reserve(INITIAL_CAPACITY))
     {
         cn_error_exit("Failed to allocate memory for database");
     }
     db.count = 0;
     db.next_id = 1;
+    cn_idmap_clear();
+}
+
+/* Grow one column to `capacity` entries of `size` bytes */
+static int grow_column(void **column, size_t size, size_t capacity)
+{
+    void *grown = realloc(*column, capacity * size);
+    if (!grown)
+        return 0;
+    *column = grown;
+    return 1;
+}
+
+int cn_db_reserve(size_t capacity)
+{
+    if (capacity <= db.capacity && db.ids)
+        return 1;
+    if (capacity > SIZE_MAX / sizeof(cn_text))
+        return 0;
+
+    /* A failure leaves the grown columns larger than db.capacity: harmless */
+    if (!grow_column((void **)&db.ids, sizeof(*db.ids), capacity) ||
+        !grow_column((void **)&db.created_at, sizeof(*db.created_at), capacity) ||
+        !grow_column((void **)&db.modified_at, sizeof(*db.modified_at), capacity) ||
+        !grow_column((void **)&db.titles, sizeof(*db.titles), capacity) ||
+        !grow_column((void **)&db.tags, sizeof(*db.tags), capacity) ||
+        !grow_column((void **)&db.previews, sizeof(*db.previews), capacity) ||
+        !grow_column((void **)&db.contents, sizeof(*db.contents), capacity) ||
+        !grow_column((void **)&db.tag_ids, sizeof(*db.tag_ids), capacity))
+        return 0;
+    db.capacity = capacity;
+    return 1;
+}
+
+void cn_db_move_note(size_t to, size_t from)
+{
+    db.ids[to] = db.ids[from];
+    db.created_at[to] = db.created_at[from];
+    db.modified_at[to] = db.modified_at[from];
+    db.titles[to] = db.titles[from];
+    db.tags[to] = db.tags[from];
+    db.previews[to] = db.previews[from];
+    db.contents[to] = db.contents[from];
+    db.tag_ids[to] = db.tag_ids[from];
+}
+
+/* Copy every live string of `column` into `fresh` */
+static void move_column_text(cn_arena *fresh, cn_text *column)
+{
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        const char *str = cn_arena_store(fresh, column[i].str, column[i].len);
+        if (!str)
+            cn_error_exit("Failed to allocate memory for database");
+        column[i].str = str;
+    }
+}
+
+void cn_db_text_compact(void)
+{
+    if (db.readonly)
+        return;
+
+    if (cn_arena_wants_compact(&db.meta_text))
+    {
+        cn_tags_clear(); /* its id lists live here too; rebuilt on demand */
+        cn_arena fresh = {0};
+        move_column_text(&fresh, db.titles);
+        move_column_text(&fresh, db.tags);
+        move_column_text(&fresh, db.previews);
+        cn_arena_free(&db.meta_text);
+        db.meta_text = fresh;
+    }
+    if (cn_arena_wants_compact(&db.content_text))
+    {
+        cn_arena fresh = {0};
+        move_column_text(&fresh, db.contents);
+        cn_arena_free(&db.content_text);
+        db.content_text = fresh;
+    }
 }
 
 /*
@@ -118,102 +216,789 @@ void cn_set_db_path(const char *path)
     cn_safe_strncpy(db_path, path, sizeof(db_path));
 }
 
-/*
- * Load database from disk (binary format). If file missing or corrupt,
- * initializes an empty DB.
+/* ------------------------------------------------------------
+ * On-disk format
+ * ------------------------------------------------------------
+ *
+ * v6 (current), all integers in host byte order:
+ *
+ *   header   : magic "CNDB" | u32 version | u32 byte-order mark | u32 next_id | u64 count
+ *              | u64 generation | u64 content_offset | u64 content_size | u64 db_id
+ *   metadata : count records of
+ *              i64 created_at | i64 modified_at | u32 id
+ *              | u32 title_len | u32 content_len | u32 tags_len | u64 content_off
+ *              | u32 preview_len | u32 reserved (0)
+ *              | title bytes NUL | tags bytes NUL | preview bytes NUL
+ *   contents : content_size bytes at file offset content_offset, each note's
+ *              content bytes NUL at content_off within it
+ *
+ * Records are variable length, so the file tracks the actual text volume
+ * instead of a fixed size per note. Every field keeps its NUL terminator
+ * on disk so a mapped file can hand out C strings in place. Contents sit
+ * apart from the metadata, so loading titles, tags and timestamps reads a
+ * dense prefix of the file and content pages are only read for the notes
+ * that are shown or searched (see map_contents). The preview (first line
+ * of the content, cn_note_preview) is stored with the metadata so compact
+ * listings never read contents either.
+ *
+ * `generation` is bumped on every full save and names the base file the
+ * write-ahead journal (journal.c) applies to. `db_id` is drawn at random on
+ * every full save, so files derived from this one (the search index) can
+ * tell it from another database that reached the same generation.
+ *
+ * v5 files are v6 without db_id (read as 0). v4 files also lack the
+ * preview fields; previews are computed from the contents when they are
+ * loaded.
+ *
+ * v3 files interleave the fields instead, one record per note:
+ *   i64 created_at | i64 modified_at | u32 id | u32 title_len | u32 content_len
+ *   | u32 tags_len | title bytes NUL | content bytes NUL | tags bytes NUL
+ * which is also the payload of a journal PUT entry. v2 files are v3 minus
+ * the generation field (read as 0). v2-v5 files are still read and are
+ * rewritten as v6 by the next full save.
+ *
+ * Legacy (v1) files are a raw dump: [size_t count][unsigned next_id][note...]
+ * of the fixed-size struct below.
+ * They are still read and are rewritten as v6 by the first commit after loading.
  */
-void cn_db_load(void)
+
+#define CN_DB_MAGIC "CNDB"
+#define CN_DB_FORMAT_VERSION 6u
+#define CN_DB_BYTE_ORDER_MARK 0x01020304u
+#define CN_DB_IO_BUFSZ (1u << 20)
+
+/* Fold the journal into the base file once it is both larger than this and
+ * at least 1/CN_JOURNAL_COMPACT_RATIO of the base file, which keeps the
+ * amortized cost of compaction constant per journaled byte. */
+#define CN_JOURNAL_COMPACT_MIN (1u << 20)
+#define CN_JOURNAL_COMPACT_RATIO 4u
+
+typedef struct cn_db_file_header
 {
-    const char *path = cn_get_db_path();
-    if (!path || path[0] == '\0')
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t next_id;
+    uint64_t count;
+    uint64_t generation;     /* v3+ */
+    uint64_t content_offset; /* v4+ */
+    uint64_t content_size;   /* v4+ */
+    uint64_t db_id;          /* v6+ */
+} cn_db_file_header;
+
+#define CN_DB_V2_HEADER_SIZE offsetof(cn_db_file_header, generation)
+#define CN_DB_V3_HEADER_SIZE offsetof(cn_db_file_header, content_offset)
+#define CN_DB_V4_HEADER_SIZE offsetof(cn_db_file_header, db_id) /* and v5 */
+
+typedef struct cn_db_record_header
+{
+    int64_t created_at;
+    int64_t modified_at;
+    uint32_t id;
+    uint32_t title_len;
+    uint32_t content_len;
+    uint32_t tags_len;
+} cn_db_record_header;
+
+/* v4+ metadata record: the v3 header plus where the content lives */
+typedef struct cn_db_meta_header
+{
+    cn_db_record_header rec;
+    uint64_t content_off;
+    uint32_t preview_len; /* v5+ */
+    uint32_t reserved;    /* v5+ */
+} cn_db_meta_header;
+
+#define CN_DB_V4_META_SIZE offsetof(cn_db_meta_header, preview_len)
+
+/* Size of a metadata record header in a v4+ file */
+static size_t meta_header_size(uint32_t version)
+{
+    return version >= 5 ? sizeof(cn_db_meta_header) : CN_DB_V4_META_SIZE;
+}
+
+/* v1 note layout: the fixed-size in-memory struct of the original releases */
+typedef struct cn_db_legacy_note
+{
+    unsigned int id;
+    char title[MAX_TITLE_LEN];
+    char content[MAX_CONTENT_LEN];
+    char tags[MAX_TAGS_LEN];
+    time_t created_at;
+    time_t modified_at;
+} cn_db_legacy_note;
+
+/* Read-only mode keeps the journal mapped: replayed records point into it */
+static cn_journal ro_journal;
+
+/* Validate the fixed part of a header. Returns its on-disk size, or 0 if the
+ * magic does not match. Exits on files from an incompatible writer. */
+static size_t check_header(const cn_db_file_header *hdr)
+{
+    if (memcmp(hdr->magic, CN_DB_MAGIC, sizeof(hdr->magic)) != 0)
+        return 0;
+    if (hdr->version < 2 || hdr->version > CN_DB_FORMAT_VERSION ||
+        hdr->byte_order != CN_DB_BYTE_ORDER_MARK)
+        cn_error_exit("Database was written by an incompatible version or platform");
+    if (hdr->version >= 6)
+        return sizeof(cn_db_file_header);
+    if (hdr->version >= 4)
+        return CN_DB_V4_HEADER_SIZE;
+    return hdr->version == 3 ? CN_DB_V3_HEADER_SIZE : CN_DB_V2_HEADER_SIZE;
+}
+
+/* Size the columns for file_count records, with some headroom to reduce
+ * reallocs on subsequent adds. Exits on allocation failure.
+ */
+static void reserve_for(size_t file_count)
+{
+    size_t cap = (file_count < INITIAL_CAPACITY) ? INITIAL_CAPACITY : file_count;
+    if (cap < file_count * GROWTH_FACTOR && file_count * GROWTH_FACTOR <= MAX_NOTES)
+        cap = file_count * GROWTH_FACTOR;
+
+    if (!cn_db_reserve(cap))
+        cn_error_exit("Failed to allocate memory for database");
+}
+
+/* Fill the non-text columns of `slot` from a record header */
+static void set_note_header(size_t slot, const cn_db_record_header *rec)
+{
+    db.ids[slot] = rec->id;
+    db.created_at[slot] = (time_t)rec->created_at;
+    db.modified_at[slot] = (time_t)rec->modified_at;
+}
+
+/* Whether a record's field lengths are within the limits */
+static int record_lengths_ok(const cn_db_record_header *rec)
+{
+    return rec->title_len < MAX_TITLE_LEN && rec->content_len < MAX_CONTENT_LEN &&
+           rec->tags_len < MAX_TAGS_LEN;
+}
+
+/* Read one NUL-terminated field of `len` bytes from f into `arena` and
+ * point `out` at it. Returns 1 on success, 0 on short read or bad data. */
+static int read_field(FILE *f, cn_arena *arena, uint32_t len, cn_text *out)
+{
+    char *str = cn_arena_alloc(arena, (size_t)len + 1);
+    if (!str)
+        cn_error_exit("Failed to allocate memory for database");
+    if (fread(str, 1, (size_t)len + 1, f) != (size_t)len + 1 || str[len] != '\0')
+        return 0;
+    out->str = str;
+    out->len = len;
+    return 1;
+}
+
+/* Set the preview of `slot` from its content (files without stored
+ * previews), in the metadata arena */
+static void derive_preview(size_t slot)
+{
+    char preview[MAX_PREVIEW_LEN + 1];
+    size_t len = cn_note_preview(db.contents[slot].str, db.contents[slot].len, preview);
+    db.previews[slot].str = cn_arena_store(&db.meta_text, preview, len);
+    db.previews[slot].len = len;
+    if (!db.previews[slot].str)
+        cn_error_exit("Failed to allocate memory for database");
+}
+
+/* Load the interleaved records following an already-validated v2/v3
+ * header, reading each field straight into its arena.
+ * Returns 1 on success (db replaced), 0 if the records are corrupted.
+ */
+static int load_records(FILE *f, const cn_db_file_header *hdr)
+{
+    size_t file_count = (size_t)hdr->count;
+
+    cn_db_init();
+    db.next_id = hdr->next_id;
+    if (file_count == 0)
+        return 1;
+    reserve_for(file_count);
+
+    for (size_t i = 0; i < file_count; ++i)
     {
-        cn_info_msg("No database path available; starting with in-memory DB");
-        cn_db_init();
-        return;
+        cn_db_record_header rec;
+
+        if (fread(&rec, sizeof(rec), 1, f) != 1 || !record_lengths_ok(&rec) ||
+            !read_field(f, &db.meta_text, rec.title_len, &db.titles[i]) ||
+            !read_field(f, &db.content_text, rec.content_len, &db.contents[i]) ||
+            !read_field(f, &db.meta_text, rec.tags_len, &db.tags[i]))
+        {
+            cn_db_cleanup();
+            return 0;
+        }
+        set_note_header(i, &rec);
+        derive_preview(i);
+        db.count = i + 1;
     }
+    return 1;
+}
 
-    FILE *f = fopen(path, "rb");
-    if (!f)
+#if !defined(_WIN32) && !defined(_WIN64)
+/* Point the content column into a read-only mapping of the file's content
+ * section (offs[i] within it for note i), so a content page is only read
+ * from disk once something looks at that note's content. The mapping stays
+ * valid after a writer renames a new file into place.
+ * Returns 1 on success, 0 if the file cannot be mapped. */
+static int map_contents(FILE *f, const cn_db_file_header *hdr, const uint64_t *offs)
+{
+    struct stat st;
+    int fd = fileno(f);
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        return 0;
+
+    size_t len = (size_t)st.st_size;
+    if (hdr->content_offset > len || hdr->content_size > len - hdr->content_offset)
+        return 0;
+    void *base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        return 0;
+    (void)posix_madvise(base, len, POSIX_MADV_RANDOM);
+
+    /* Offsets were checked against content_size; a final NUL keeps every
+     * string inside the mapping even if a terminator in between is damaged */
+    const char *heap = (const char *)base + hdr->content_offset;
+    if (heap[hdr->content_size - 1] != '\0')
     {
-        /* Not an error: start fresh */
-        cn_db_init();
-        return;
+        munmap(base, len);
+        return 0;
     }
+    for (size_t i = 0; i < db.count; ++i)
+        db.contents[i].str = heap + offs[i];
+
+    /* Counted as live content text, so edits and deletes release mapped
+     * contents like arena ones and compaction copies them to the heap */
+    db.content_text.live += (size_t)hdr->content_size;
+    db.map_base = base;
+    db.map_len = len;
+    return 1;
+}
+#endif
+
+/* Read every note's content (offs[i] within the content section) into the
+ * content arena. Returns 1 on success, 0 on short read or bad data. */
+static int read_contents(FILE *f, const cn_db_file_header *hdr, const uint64_t *offs)
+{
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        uint64_t at = hdr->content_offset + offs[i];
+        if (at > LONG_MAX || fseek(f, (long)at, SEEK_SET) != 0 ||
+            !read_field(f, &db.content_text, (uint32_t)db.contents[i].len, &db.contents[i]))
+            return 0;
+    }
+    return 1;
+}
 
+/* Load the records of a v4+ file: metadata straight into the arena, then
+ * the contents mapped (map_contents) or, where that is not possible, read.
+ * v4 files have no stored previews, so theirs are derived from the contents.
+ * Returns 1 on success (db replaced), 0 if the records are corrupted.
+ */
+static int load_split_records(FILE *f, const cn_db_file_header *hdr)
+{
+    size_t file_count = (size_t)hdr->count;
+
+    cn_db_init();
+    db.next_id = hdr->next_id;
+    if (file_count == 0)
+        return 1;
+    reserve_for(file_count);
+
+    uint64_t *offs = malloc(file_count * sizeof(*offs));
+    if (!offs)
+        cn_error_exit("Failed to allocate memory for database");
+
+    int stored_previews = hdr->version >= 5;
+    size_t meta_size = meta_header_size(hdr->version);
+    int ok = 1;
+    for (size_t i = 0; ok && i < file_count; ++i)
+    {
+        cn_db_meta_header meta;
+        meta.preview_len = 0;
+
+        ok = fread(&meta, meta_size, 1, f) == 1 && record_lengths_ok(&meta.rec) &&
+             meta.preview_len <= MAX_PREVIEW_LEN &&
+             meta.content_off < hdr->content_size &&
+             meta.rec.content_len < hdr->content_size - meta.content_off &&
+             read_field(f, &db.meta_text, meta.rec.title_len, &db.titles[i]) &&
+             read_field(f, &db.meta_text, meta.rec.tags_len, &db.tags[i]) &&
+             (!stored_previews || read_field(f, &db.meta_text, meta.preview_len, &db.previews[i]));
+        if (ok)
+        {
+            set_note_header(i, &meta.rec);
+            db.contents[i].len = meta.rec.content_len;
+            offs[i] = meta.content_off;
+            db.count = i + 1;
+        }
+    }
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    ok = ok && (map_contents(f, hdr, offs) || read_contents(f, hdr, offs));
+#else
+    ok = ok && read_contents(f, hdr, offs);
+#endif
+    free(offs);
+    for (size_t i = 0; ok && !stored_previews && i < db.count; ++i)
+        derive_preview(i);
+    if (!ok)
+    {
+        cn_db_cleanup();
+        return 0;
+    }
+    return 1;
+}
+
+/* Store a legacy field (forcibly terminated) in `arena` */
+static void store_legacy_field(cn_arena *arena, char *field, size_t size, cn_text *out)
+{
+    field[size - 1] = '\0';
+    out->len = strlen(field);
+    out->str = cn_arena_store(arena, field, out->len);
+    if (!out->str)
+        cn_error_exit("Failed to allocate memory for database");
+}
+
+/* Load a legacy fixed-size dump from the start of the file.
+ * Returns 1 on success (db replaced), 0 on a corrupted file.
+ */
+static int load_legacy(FILE *f)
+{
     size_t file_count = 0;
     unsigned int file_next_id = 0;
 
     if (fread(&file_count, sizeof(size_t), 1, f) != 1 ||
         fread(&file_next_id, sizeof(unsigned int), 1, f) != 1)
+        return 0;
+
+    if (file_count > MAX_NOTES || file_next_id == 0)
+        return 0;
+
+    cn_db_init();
+    db.next_id = file_next_id; /* preserve next_id */
+    if (file_count == 0)
+        return 1;
+    reserve_for(file_count);
+
+    cn_db_legacy_note *old = malloc(sizeof(*old));
+    if (!old)
+        cn_error_exit("Failed to allocate memory for database");
+
+    for (size_t i = 0; i < file_count; ++i)
+    {
+        if (fread(old, sizeof(*old), 1, f) != 1)
+        {
+            free(old);
+            cn_db_cleanup();
+            return 0;
+        }
+
+        /* Legacy records are raw structs: force termination of every field */
+        store_legacy_field(&db.meta_text, old->title, sizeof(old->title), &db.titles[i]);
+        store_legacy_field(&db.content_text, old->content, sizeof(old->content), &db.contents[i]);
+        store_legacy_field(&db.meta_text, old->tags, sizeof(old->tags), &db.tags[i]);
+        derive_preview(i);
+        db.ids[i] = old->id;
+        db.created_at[i] = old->created_at;
+        db.modified_at[i] = old->modified_at;
+        db.count = i + 1;
+    }
+    free(old);
+    return 1;
+}
+
+/* Fill the fixed record header for a heap note */
+static void fill_record_header(size_t slot, cn_db_record_header *rec)
+{
+    rec->created_at = (int64_t)db.created_at[slot];
+    rec->modified_at = (int64_t)db.modified_at[slot];
+    rec->id = db.ids[slot];
+    rec->title_len = (uint32_t)db.titles[slot].len;
+    rec->content_len = (uint32_t)db.contents[slot].len;
+    rec->tags_len = (uint32_t)db.tags[slot].len;
+}
+
+/* Encode a heap note as one contiguous record (journal payload).
+ * Returns a malloc'd buffer and its size in *len_out, or NULL. */
+static unsigned char *encode_record(size_t slot, size_t *len_out)
+{
+    cn_db_record_header rec;
+    fill_record_header(slot, &rec);
+
+    size_t len = sizeof(rec) + (size_t)rec.title_len + rec.content_len + rec.tags_len + 3;
+    unsigned char *buf = malloc(len);
+    if (!buf)
+        return NULL;
+
+    unsigned char *p = buf;
+    memcpy(p, &rec, sizeof(rec));
+    p += sizeof(rec);
+    memcpy(p, db.titles[slot].str, (size_t)rec.title_len + 1);
+    p += rec.title_len + 1;
+    memcpy(p, db.contents[slot].str, (size_t)rec.content_len + 1);
+    p += rec.content_len + 1;
+    memcpy(p, db.tags[slot].str, (size_t)rec.tags_len + 1);
+
+    *len_out = len;
+    return buf;
+}
+
+/* Check that a record (header + three NUL-terminated fields) fits in `avail`
+ * bytes at `p`. Returns its total size, or 0 if malformed. */
+static size_t validate_record(const unsigned char *p, size_t avail)
+{
+    cn_db_record_header rec;
+    if (avail < sizeof(rec))
+        return 0;
+    memcpy(&rec, p, sizeof(rec));
+
+    if (!record_lengths_ok(&rec))
+        return 0;
+
+    size_t text_len = (size_t)rec.title_len + rec.content_len + rec.tags_len + 3;
+    if (avail - sizeof(rec) < text_len)
+        return 0;
+
+    const unsigned char *text = p + sizeof(rec);
+    if (text[rec.title_len] != '\0' ||
+        text[rec.title_len + 1 + rec.content_len] != '\0' ||
+        text[text_len - 1] != '\0')
+        return 0;
+
+    return sizeof(rec) + text_len;
+}
+
+/* Decode a validated record at `p` into a view whose string fields point
+ * straight into the record bytes.
+ */
+static void decode_record(const unsigned char *p, cn_note_view *out)
+{
+    cn_db_record_header rec;
+    memcpy(&rec, p, sizeof(rec)); /* records are not aligned in the file */
+
+    const char *text = (const char *)p + sizeof(rec);
+    out->id = rec.id;
+    out->created_at = (time_t)rec.created_at;
+    out->modified_at = (time_t)rec.modified_at;
+    out->title = text;
+    out->title_len = rec.title_len;
+    out->content = text + rec.title_len + 1;
+    out->content_len = rec.content_len;
+    out->tags = out->content + rec.content_len + 1;
+    out->tags_len = rec.tags_len;
+}
+
+/* Create the database's parent directory if needed. Returns NULL or an error. */
+static const char *ensure_db_dir(const char *path)
+{
+    char parent[PATH_MAX];
+    if (path_dirname(path, parent, sizeof(parent)) && parent[0])
+    {
+        if (!make_parent_dirs(parent))
+            return "Failed to create database directory";
+    }
+    return NULL;
+}
+
+/* Flush `f` through to the disk */
+static int sync_file(FILE *f)
+{
+    if (fflush(f) != 0)
+        return 0;
+#if defined(_WIN32) || defined(_WIN64)
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+/* Make a rename into the directory of `path` durable. Filesystems that
+ * cannot sync a directory (EINVAL) count as success. */
+static int sync_parent_dir(const char *path)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    (void)path;
+    return 1; /* NTFS journals the rename itself */
+#else
+    char parent[PATH_MAX];
+    if (!path_dirname(path, parent, sizeof(parent)))
+        return 0;
+    const char *dir = parent[0] ? parent : (path[0] == '/' ? "/" : ".");
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    int ok = fsync(fd) == 0 || errno == EINVAL;
+    close(fd);
+    return ok;
+#endif
+}
+
+/* A fresh random database id (never 0, which means "unknown") */
+static uint64_t new_db_id(void)
+{
+    uint64_t id = 0;
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f)
     {
+        if (fread(&id, sizeof(id), 1, f) != 1)
+            id = 0;
         fclose(f);
-        cn_info_msg("Database header corrupted, starting fresh");
-        cn_db_init();
-        return;
     }
+    if (id == 0)
+    {
+        /* no urandom: mix the clock and a stack address (splitmix64) */
+        id = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^ (uint64_t)(uintptr_t)&id;
+        id += 0x9e3779b97f4a7c15u;
+        id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9u;
+        id = (id ^ (id >> 27)) * 0x94d049bb133111ebu;
+        id ^= id >> 31;
+    }
+    return id ? id : 1;
+}
 
-    if (file_count > MAX_NOTES || file_next_id == 0)
+/*
+ * Write the whole database to `path` atomically (temp file + rename),
+ * stamped with `generation` and `db_id`. Returns NULL on success or a static error
+ * message on failure; the temporary file is removed on every failure path.
+ */
+static const char *db_write_file(const char *path, uint64_t generation, uint64_t db_id)
+{
+    const char *err = ensure_db_dir(path);
+    if (err)
+        return err;
+
+    /* Unique temporary file next to the database */
+    char tmp[PATH_MAX + 16];
+    FILE *f = cn_temp_open(path, tmp, sizeof(tmp));
+    if (!f)
+        return "Failed to open temporary database file for writing";
+    setvbuf(f, NULL, _IOFBF, CN_DB_IO_BUFSZ);
+
+    /* Metadata first, so its size places the content section */
+    uint64_t meta_size = 0, content_size = 0;
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        meta_size += sizeof(cn_db_meta_header) + db.titles[i].len + db.tags[i].len +
+                     db.previews[i].len + 3;
+        content_size += db.contents[i].len + 1;
+    }
+
+    cn_db_file_header hdr;
+    memcpy(hdr.magic, CN_DB_MAGIC, sizeof(hdr.magic));
+    hdr.version = CN_DB_FORMAT_VERSION;
+    hdr.byte_order = CN_DB_BYTE_ORDER_MARK;
+    hdr.next_id = db.next_id;
+    hdr.count = (uint64_t)db.count;
+    hdr.generation = generation;
+    hdr.content_offset = sizeof(hdr) + meta_size;
+    hdr.content_size = content_size;
+    hdr.db_id = db_id;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
     {
         fclose(f);
-        cn_info_msg("Database parameters invalid, starting fresh");
-        cn_db_init();
-        return;
+        (void)remove(tmp);
+        return "Failed to write database header";
     }
 
-    if (file_count == 0)
+    uint64_t content_off = 0;
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        cn_db_meta_header meta;
+        fill_record_header(i, &meta.rec);
+        meta.content_off = content_off;
+        meta.preview_len = (uint32_t)db.previews[i].len;
+        meta.reserved = 0;
+        content_off += (uint64_t)meta.rec.content_len + 1;
+
+        if (fwrite(&meta, sizeof(meta), 1, f) != 1 ||
+            fwrite(db.titles[i].str, 1, (size_t)meta.rec.title_len + 1, f) != (size_t)meta.rec.title_len + 1 ||
+            fwrite(db.tags[i].str, 1, (size_t)meta.rec.tags_len + 1, f) != (size_t)meta.rec.tags_len + 1 ||
+            fwrite(db.previews[i].str, 1, (size_t)meta.preview_len + 1, f) != (size_t)meta.preview_len + 1)
+        {
+            fclose(f);
+            (void)remove(tmp);
+            return "Failed to write database records";
+        }
+    }
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        if (fwrite(db.contents[i].str, 1, db.contents[i].len + 1, f) != db.contents[i].len + 1)
+        {
+            fclose(f);
+            (void)remove(tmp);
+            return "Failed to write database contents";
+        }
+    }
+
+    /* The rename must not become durable before the data it points at:
+     * the caller drops the journal next */
+    if (!sync_file(f))
     {
         fclose(f);
+        (void)remove(tmp);
+        return "Failed to sync temporary database file";
+    }
+    if (fclose(f) != 0)
+    {
+        (void)remove(tmp);
+        return "Failed to close temporary database file";
+    }
+
+    /* Atomic rename to final path */
+    if (rename(tmp, path) != 0)
+    {
+        (void)remove(tmp);
+        return "Failed to update database file";
+    }
+    if (!sync_parent_dir(path))
+        return "Failed to sync database directory";
+    return NULL;
+}
+
+/* Load the base file into the heap. Returns 1 if the DB reflects the file
+ * (including "no file yet"), 0 if it was corrupted and reset to empty. */
+static int load_base_file(const char *path)
+{
+    db.legacy_base = 0;
+    db.db_id = 0;
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        /* Not an error: start fresh (any journal belongs to generation 0) */
         cn_db_init();
-        db.next_id = file_next_id; /* preserve next_id */
-        return;
+        db.generation = 0;
+        return 1;
     }
+    setvbuf(f, NULL, _IOFBF, CN_DB_IO_BUFSZ);
 
-    /* Compute capacity (grow a bit to reduce reallocs) */
-    size_t cap = (file_count < INITIAL_CAPACITY) ? INITIAL_CAPACITY : file_count;
-    if (cap < file_count * GROWTH_FACTOR && file_count * GROWTH_FACTOR <= MAX_NOTES)
-        cap = file_count * GROWTH_FACTOR;
+    cn_db_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    size_t hdr_size = 0;
+    if (fread(&hdr, CN_DB_V2_HEADER_SIZE, 1, f) == 1)
+        hdr_size = check_header(&hdr);
 
-    /* allocate space */
-    cn_note *notes = calloc(cap, sizeof(cn_note));
-    if (!notes)
+    if (hdr_size)
     {
+        if (hdr_size > CN_DB_V2_HEADER_SIZE &&
+            fread(&hdr.generation, hdr_size - CN_DB_V2_HEADER_SIZE, 1, f) != 1)
+        {
+            fclose(f);
+            cn_info_msg("Database header corrupted, starting fresh");
+            cn_db_init();
+            return 0;
+        }
+        if (hdr.count > MAX_NOTES || hdr.next_id == 0)
+        {
+            fclose(f);
+            cn_info_msg("Database parameters invalid, starting fresh");
+            cn_db_init();
+            return 0;
+        }
+        int loaded = hdr.version >= 4 ? load_split_records(f, &hdr) : load_records(f, &hdr);
+        if (!loaded)
+        {
+            fclose(f);
+            cn_info_msg("Database records corrupted, starting fresh");
+            cn_db_init();
+            return 0;
+        }
         fclose(f);
-        cn_error_exit("Failed to allocate memory for database");
+        db.generation = hdr.generation;
+        db.db_id = hdr.db_id;
+        return 1;
     }
 
-    size_t actually_read = fread(notes, sizeof(cn_note), file_count, f);
-    if (actually_read != file_count)
+    rewind(f);
+    int ok = load_legacy(f);
+    fclose(f);
+    if (!ok)
     {
-        free(notes);
-        fclose(f);
-        cn_info_msg("Database records corrupted, starting fresh");
+        cn_info_msg("Database header corrupted, starting fresh");
         cn_db_init();
+        return 0;
+    }
+
+    /* Migrated in memory only: loads may run under the shared lock next to
+     * other readers, so the file is rewritten by the next commit instead */
+    db.generation = 0;
+    db.legacy_base = 1;
+    return 1;
+}
+
+/* Apply journal entries on top of the heap DB */
+static void replay_journal_heap(const char *path)
+{
+    cn_journal j;
+    db.journal_len = 0;
+    if (!cn_journal_open(&j, path, db.generation))
         return;
+
+    cn_journal_entry e;
+    while (cn_journal_next(&j, &e))
+    {
+        if (e.op == CN_JOURNAL_PUT && validate_record(e.payload, e.payload_len) == e.payload_len)
+        {
+            cn_note_view note;
+            decode_record(e.payload, &note);
+            if (!cn_note_put(&note))
+                cn_error_exit("Failed to replay database journal");
+        }
+        else if (e.op == CN_JOURNAL_DEL)
+        {
+            (void)cn_note_delete(e.id);
+        }
     }
 
-    /* loaded OK: replace current db */
-    db.notes = notes;
-    db.count = file_count;
-    db.capacity = cap;
-    db.next_id = file_next_id;
+    db.journal_len = j.valid_len;
+    cn_journal_close(&j);
+}
 
-    fclose(f);
+/*
+ * Load database from disk: the base file (current, v2 or legacy layout,
+ * the latter migrated in memory and on disk by the next commit) plus any
+ * journaled mutations. If the file
+ * is missing or corrupt, initializes an empty DB.
+ */
+void cn_db_load(void)
+{
+    const char *path = cn_get_db_path();
+    if (!path || path[0] == '\0')
+    {
+        cn_info_msg("No database path available; starting with in-memory DB");
+        cn_db_init();
+        return;
+    }
+
+    /* Shared: the base file and journal must be read as one state */
+    int prev = cn_db_lock(CN_LOCK_SHARED);
+    int replay = load_base_file(path);
+    cn_idmap_rebuild();
+    if (replay)
+        replay_journal_heap(path);
+    cn_db_lock_restore(prev);
+    db.loaded_next_id = db.next_id;
 
     /* Basic sanitization */
     for (size_t i = 0; i < db.count; ++i)
     {
-        db.notes[i].title[MAX_TITLE_LEN - 1] = '\0';
-        db.notes[i].content[MAX_CONTENT_LEN - 1] = '\0';
-        db.notes[i].tags[MAX_TAGS_LEN - 1] = '\0';
-        if (db.notes[i].id == 0 || db.notes[i].created_at < 0 || db.notes[i].modified_at < 0)
+        if (db.ids[i] == 0 || db.created_at[i] < 0 || db.modified_at[i] < 0)
         {
             cn_info_msg("Found possibly corrupted record(s) in DB; continuing with preserved data");
+            break;
         }
     }
 }
 
+/* Batch mode (cn_db_defer_commits): commits only mark the database dirty
+ * and cn_db_flush saves it whole. The caller holds the exclusive lock. */
+static int defer_commits;
+static int commits_pending;
+
 /*
- * Save database to disk atomically (write to temp + rename).
+ * Save database to disk atomically (write to temp + rename) under a new
+ * generation, then drop the journal whose entries it now contains. The
+ * journal goes only once the new file and its directory entry are synced,
+ * so a crash in between never leaves neither on disk.
  * On any write error the function will call cn_error_exit.
  */
 void cn_db_save(void)
@@ -224,72 +1009,546 @@ void cn_db_save(void)
         cn_error_exit("No database path available");
     }
 
-    /* Ensure parent directory exists */
-    char parent[PATH_MAX];
-    if (path_dirname(path, parent, sizeof(parent)) && parent[0])
+    const char *err = ensure_db_dir(path);
+    if (err)
+        cn_error_exit(err);
+
+    int prev = cn_db_lock(CN_LOCK_EXCLUSIVE);
+    uint64_t db_id = new_db_id();
+    err = db_write_file(path, db.generation + 1, db_id);
+    if (err)
+        cn_error_exit(err);
+
+    db.generation++;
+    db.db_id = db_id;
+    db.legacy_base = 0;
+    commits_pending = 0;
+    cn_journal_remove(path);
+    db.journal_len = 0;
+    cn_db_lock_restore(prev);
+}
+
+/* Size of the base file alone (0 if it does not exist) */
+static size_t base_file_size(const char *path)
+{
+    struct stat st;
+    if (!path || path[0] == '\0' || stat(path, &st) != 0)
+        return 0;
+    return (size_t)st.st_size;
+}
+
+/* Append one journal entry for the current generation; exits on failure */
+static void journal_append(const char *path, uint32_t op, unsigned int id, time_t ts,
+                           const void *payload, size_t payload_len)
+{
+    const char *err = ensure_db_dir(path);
+    if (err)
+        cn_error_exit(err);
+
+    size_t len = cn_journal_append(path, db.generation, db.journal_len, op, id, ts,
+                                   payload, payload_len);
+    if (len == 0)
+        cn_error_exit("Failed to write database journal");
+    db.journal_len = len;
+
+    if (db.journal_len >= CN_JOURNAL_COMPACT_MIN &&
+        db.journal_len >= base_file_size(path) / CN_JOURNAL_COMPACT_RATIO)
+        cn_db_save();
+}
+
+/* Generation stamped in the base file on disk (0 if none or unreadable) */
+static uint64_t disk_generation(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    cn_db_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    size_t n = fread(&hdr, 1, CN_DB_V3_HEADER_SIZE, f);
+    fclose(f);
+    if (n < CN_DB_V3_HEADER_SIZE || memcmp(hdr.magic, CN_DB_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version < 3)
+        return 0;
+    return hdr.generation;
+}
+
+/* Whether another process changed the base file or journal since this one
+ * loaded them. Call with the lock held. */
+static int disk_changed(const char *path)
+{
+    if (disk_generation(path) != db.generation)
+        return 1;
+    char wal[PATH_MAX];
+    struct stat st;
+    size_t wal_len = 0;
+    if (cn_journal_path(path, wal, sizeof(wal)) && stat(wal, &st) == 0)
+        wal_len = (size_t)st.st_size;
+    return wal_len != db.journal_len;
+}
+
+/* Replace the in-memory state with what is on disk now (lock held) */
+static void reload(void)
+{
+    cn_db_cleanup();
+    cn_db_load();
+}
+
+/*
+ * Durably record the current state of note `id` (after add or edit).
+ *
+ * If another process committed in the meantime, the database is reloaded
+ * and this change re-applied on top: a note added by this process takes
+ * the next free id (returned, so callers report the right one); an edit
+ * copies only the changed `fields` (CN_FIELD_*) onto the reloaded note, so
+ * concurrent edits of other fields survive, unless the note has been
+ * deleted, which is an error.
+ */
+unsigned int cn_db_commit_note(unsigned int id, unsigned int fields)
+{
+    const char *path = cn_get_db_path();
+    if (!path || path[0] == '\0')
+        cn_error_exit("No database path available");
+
+    size_t slot = cn_idmap_find(id);
+    if (slot == SIZE_MAX || db.readonly)
+        cn_error_exit("Note not found");
+    if (defer_commits)
     {
-        if (!make_parent_dirs(parent))
+        commits_pending = 1;
+        return id;
+    }
+
+    const char *err = ensure_db_dir(path);
+    if (err)
+        cn_error_exit(err);
+    int prev = cn_db_lock(CN_LOCK_EXCLUSIVE);
+
+    if (disk_changed(path))
+    {
+        /* Our version of the note, copied out before reload() frees it */
+        cn_note_view mine;
+        cn_db_note_view(slot, &mine);
+        char *text = malloc(mine.title_len + mine.content_len + mine.tags_len + 3);
+        if (!text)
+            cn_error_exit("Failed to allocate memory for database");
+        memcpy(text, mine.title, mine.title_len + 1);
+        memcpy(text + mine.title_len + 1, mine.content, mine.content_len + 1);
+        memcpy(text + mine.title_len + mine.content_len + 2, mine.tags, mine.tags_len + 1);
+        mine.title = text;
+        mine.content = text + mine.title_len + 1;
+        mine.tags = mine.content + mine.content_len + 1;
+        int added = id >= db.loaded_next_id;
+
+        reload();
+        if (added)
+        {
+            mine.id = db.next_id; /* ours may have been taken meanwhile */
+            if (!cn_note_put(&mine))
+                cn_error_exit("Failed to merge note into the database");
+            id = mine.id;
+        }
+        else
         {
-            cn_error_exit("Failed to create database directory");
+            /* The text is already trimmed, so cn_note_edit stores it as is */
+            if (!cn_note_edit(id, (fields & CN_FIELD_TITLE) ? mine.title : NULL,
+                              (fields & CN_FIELD_CONTENT) ? mine.content : NULL,
+                              (fields & CN_FIELD_TAGS) ? mine.tags : NULL))
+                cn_error_exit("Note was deleted by another process");
+            db.modified_at[cn_idmap_find(id)] = mine.modified_at;
         }
+        free(text);
+        slot = cn_idmap_find(id);
     }
 
-    /* Build temporary filename: "<path>.tmp" */
-    char tmp[PATH_MAX];
-    int ret = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
-    if (ret < 0 || (size_t)ret >= sizeof(tmp))
+    size_t len = 0;
+    unsigned char *rec = encode_record(slot, &len);
+    if (!rec)
+        cn_error_exit("Failed to allocate memory for journal entry");
+
+    if (db.legacy_base)
+        cn_db_save(); /* first commit on a v1 file: migrate it now */
+    else
+        journal_append(path, CN_JOURNAL_PUT, id, db.modified_at[slot], rec, len);
+    free(rec);
+    cn_db_lock_restore(prev);
+    return id;
+}
+
+/* Durably record the deletion of note `id` (re-applied after a reload if
+ * another process committed meanwhile; already gone is fine) */
+void cn_db_commit_delete(unsigned int id)
+{
+    const char *path = cn_get_db_path();
+    if (!path || path[0] == '\0')
+        cn_error_exit("No database path available");
+    if (defer_commits)
     {
-        cn_error_exit("Temporary path too long");
+        commits_pending = 1;
+        return;
     }
 
-    FILE *f = fopen(tmp, "wb");
-    if (!f)
+    const char *err = ensure_db_dir(path);
+    if (err)
+        cn_error_exit(err);
+    int prev = cn_db_lock(CN_LOCK_EXCLUSIVE);
+
+    if (disk_changed(path))
     {
-        cn_error_exit("Failed to open temporary database file for writing");
+        reload();
+        (void)cn_note_delete(id);
     }
 
-    /* Write header */
-    if (fwrite(&db.count, sizeof(size_t), 1, f) != 1 ||
-        fwrite(&db.next_id, sizeof(unsigned int), 1, f) != 1)
+    if (db.legacy_base)
+        cn_db_save();
+    else
+        journal_append(path, CN_JOURNAL_DEL, id, time(NULL), NULL, 0);
+    cn_db_lock_restore(prev);
+}
+
+void cn_db_defer_commits(int enable)
+{
+    defer_commits = enable;
+}
+
+int cn_db_commits_pending(void)
+{
+    return commits_pending;
+}
+
+void cn_db_flush(void)
+{
+    if (commits_pending)
+        cn_db_save();
+}
+
+void cn_db_refresh(void)
+{
+    const char *path = cn_get_db_path();
+    if (path && path[0] != '\0' && !db.readonly)
     {
-        fclose(f);
-        (void)remove(tmp);
-        cn_error_exit("Failed to write database header");
+        int prev = cn_db_lock(CN_LOCK_SHARED);
+        if (disk_changed(path))
+            reload();
+        cn_db_lock_restore(prev);
+    }
+    db.loaded_next_id = db.next_id;
+}
+
+/* Size of the database on disk in bytes: base file plus journal. */
+size_t cn_db_file_size(void)
+{
+    return base_file_size(cn_get_db_path()) + db.journal_len;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+/* Point the columns of `slot` at a validated record in mapped memory */
+static void set_mapped_note(size_t slot, const unsigned char *p)
+{
+    cn_note_view note;
+    decode_record(p, &note);
+    db.ids[slot] = note.id;
+    db.created_at[slot] = note.created_at;
+    db.modified_at[slot] = note.modified_at;
+    db.titles[slot] = (cn_text){note.title, note.title_len};
+    db.tags[slot] = (cn_text){note.tags, note.tags_len};
+    db.contents[slot] = (cn_text){note.content, note.content_len};
+    derive_preview(slot);
+}
+
+/* Check that a v4+ metadata record (header + title, tags and, from v5 on,
+ * preview) of a `version` file fits in `avail` bytes at `p` and that its
+ * content lies within the content section of `content_size` bytes. Only the
+ * metadata is read: content pages are left alone. Returns the record's
+ * size, or 0 if malformed. */
+static size_t validate_meta(const unsigned char *p, size_t avail, uint32_t version,
+                            uint64_t content_size)
+{
+    size_t hdr_size = meta_header_size(version);
+    cn_db_meta_header meta;
+    meta.preview_len = 0;
+    if (avail < hdr_size)
+        return 0;
+    memcpy(&meta, p, hdr_size);
+
+    if (!record_lengths_ok(&meta.rec) || meta.preview_len > MAX_PREVIEW_LEN ||
+        meta.content_off >= content_size || meta.rec.content_len >= content_size - meta.content_off)
+        return 0;
+
+    size_t text_len = (size_t)meta.rec.title_len + meta.rec.tags_len + 2;
+    if (version >= 5)
+        text_len += (size_t)meta.preview_len + 1;
+    if (avail - hdr_size < text_len)
+        return 0;
+
+    const unsigned char *text = p + hdr_size;
+    if (text[meta.rec.title_len] != '\0' ||
+        text[meta.rec.title_len + 1 + meta.rec.tags_len] != '\0' || text[text_len - 1] != '\0')
+        return 0;
+    return hdr_size + text_len;
+}
+
+/* Point the columns of `slot` at a validated v4+ metadata record of a
+ * `version` file and its content inside the mapped content section `heap`.
+ * v4 records have no stored preview: it is derived, reading the content. */
+static void set_mapped_meta(size_t slot, const unsigned char *p, uint32_t version, const char *heap)
+{
+    size_t hdr_size = meta_header_size(version);
+    cn_db_meta_header meta;
+    meta.preview_len = 0;
+    memcpy(&meta, p, hdr_size);
+
+    const char *text = (const char *)p + hdr_size;
+    set_note_header(slot, &meta.rec);
+    db.titles[slot] = (cn_text){text, meta.rec.title_len};
+    db.tags[slot] = (cn_text){text + meta.rec.title_len + 1, meta.rec.tags_len};
+    db.contents[slot] = (cn_text){heap + meta.content_off, meta.rec.content_len};
+    if (version >= 5)
+        db.previews[slot] = (cn_text){db.tags[slot].str + meta.rec.tags_len + 1, meta.preview_len};
+    else
+        derive_preview(slot);
+}
+
+/* Validate a mapped file and fill the columns from its records in place.
+ * Returns 1 on success, 0 if the mapping is not a usable v2-v6 database.
+ */
+static int index_mapped_records(const unsigned char *base, size_t len)
+{
+    cn_db_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (len < CN_DB_V2_HEADER_SIZE)
+        return 0;
+    memcpy(&hdr, base, CN_DB_V2_HEADER_SIZE);
+
+    size_t off = check_header(&hdr);
+    if (off == 0 || len < off || hdr.count > MAX_NOTES || hdr.next_id == 0)
+        return 0;
+    memcpy(&hdr, base, off);
+
+    size_t count = (size_t)hdr.count;
+    const char *heap = NULL;
+    if (hdr.version >= 4)
+    {
+        /* The section must end in a NUL so no content string can run past
+         * it, even where a terminator inside was damaged */
+        if (hdr.content_offset < off || hdr.content_offset > len ||
+            hdr.content_size > len - hdr.content_offset ||
+            (hdr.content_size > 0 && base[hdr.content_offset + hdr.content_size - 1] != '\0'))
+            return 0;
+        heap = (const char *)base + hdr.content_offset;
+
+        /* Contents are read note by note, only for the notes shown or
+         * searched: no readahead across the section */
+        long page = sysconf(_SC_PAGESIZE);
+        size_t start = page > 0 ? (size_t)hdr.content_offset / (size_t)page * (size_t)page : 0;
+        (void)posix_madvise((void *)(base + start), len - start, POSIX_MADV_RANDOM);
     }
 
-    /* Write notes */
-    if (db.count > 0)
+    if (!cn_db_reserve(count > 0 ? count : INITIAL_CAPACITY))
+        cn_error_exit("Failed to allocate memory for database");
+
+    for (size_t i = 0; i < count; ++i)
     {
-        if (fwrite(db.notes, sizeof(cn_note), db.count, f) != db.count)
+        if (heap)
         {
-            fclose(f);
-            (void)remove(tmp);
-            cn_error_exit("Failed to write database records");
+            size_t meta_len = validate_meta(base + off, hdr.content_offset - off, hdr.version,
+                                            hdr.content_size);
+            if (meta_len == 0)
+            {
+                cn_db_cleanup();
+                return 0;
+            }
+            set_mapped_meta(i, base + off, hdr.version, heap);
+            off += meta_len;
+            continue;
+        }
+
+        size_t rec_len = validate_record(base + off, len - off);
+        if (rec_len == 0)
+        {
+            cn_db_cleanup();
+            return 0;
         }
+        set_mapped_note(i, base + off);
+        off += rec_len;
     }
 
-    if (fclose(f) != 0)
+    db.count = count;
+    db.next_id = hdr.next_id;
+    db.generation = hdr.generation;
+    db.db_id = hdr.db_id;
+    return 1;
+}
+
+/* Apply journal entries to the mapped columns without copying: a PUT
+ * repoints (or appends) a slot at the record inside the mapped journal and a
+ * DEL moves the last slot into the hole, mirroring cn_note_delete. */
+static void replay_journal_mapped(const char *path)
+{
+    db.journal_len = 0;
+    if (!cn_journal_open(&ro_journal, path, db.generation))
+        return;
+
+    cn_journal_entry e;
+    while (cn_journal_next(&ro_journal, &e))
     {
-        (void)remove(tmp);
-        cn_error_exit("Failed to close temporary database file");
+        if (e.op == CN_JOURNAL_PUT && validate_record(e.payload, e.payload_len) == e.payload_len)
+        {
+            cn_db_record_header rec;
+            memcpy(&rec, e.payload, sizeof(rec));
+
+            size_t slot = cn_idmap_find(rec.id);
+            if (slot == SIZE_MAX)
+            {
+                if (db.count == db.capacity &&
+                    !cn_db_reserve(db.capacity ? db.capacity * GROWTH_FACTOR : INITIAL_CAPACITY))
+                    cn_error_exit("Failed to allocate memory for database");
+                slot = db.count++;
+                cn_idmap_set(rec.id, slot);
+            }
+            set_mapped_note(slot, e.payload);
+            if (rec.id >= db.next_id && rec.id != UINT_MAX)
+                db.next_id = rec.id + 1;
+        }
+        else if (e.op == CN_JOURNAL_DEL)
+        {
+            size_t slot = cn_idmap_find(e.id);
+            if (slot != SIZE_MAX)
+            {
+                cn_db_move_note(slot, --db.count);
+                if (slot < db.count)
+                    cn_idmap_set(db.ids[slot], slot);
+                cn_idmap_remove(e.id);
+            }
+        }
     }
 
-    /* Atomic rename to final path */
-    if (rename(tmp, path) != 0)
+    db.journal_len = ro_journal.valid_len;
+}
+#endif
+
+/*
+ * Open the database for read-only commands by mapping the file instead of
+ * copying every record's text into the arenas: the text columns point
+ * into the mapping. Falls back to cn_db_load() whenever mapping is not
+ * possible (no mmap, missing, legacy or corrupted file) so callers need
+ * not care.
+ */
+void cn_db_open_readonly(void)
+{
+    /* Shared only while the base file and journal are mapped: the mappings
+     * stay valid after writers rename or append */
+    int prev = cn_db_lock(CN_LOCK_SHARED);
+    open_readonly_locked();
+    cn_db_lock_restore(prev);
+}
+
+static void open_readonly_locked(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    cn_db_load();
+#else
+    const char *path = cn_get_db_path();
+    if (!path || path[0] == '\0')
     {
-        (void)remove(tmp);
-        cn_error_exit("Failed to update database file");
+        cn_db_load();
+        return;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        /* Nothing compacted yet; the journal alone is small */
+        cn_db_load();
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        cn_db_load();
+        return;
+    }
+
+    size_t len = (size_t)st.st_size;
+    void *base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        cn_db_load();
+        return;
     }
+    (void)posix_madvise(base, len, POSIX_MADV_SEQUENTIAL);
+
+    if (!index_mapped_records(base, len))
+    {
+        munmap(base, len);
+        cn_db_load(); /* handles migration and corruption reporting */
+        return;
+    }
+
+    db.map_base = base;
+    db.map_len = len;
+    db.readonly = 1;
+    cn_idmap_rebuild();
+    replay_journal_mapped(path);
+#endif
 }
 
-/* Free DB memory */
+/* Id of the note stored at `index` (< db.count), without touching text */
+unsigned int cn_db_note_id(size_t index)
+{
+    return db.ids[index];
+}
+
+/* Fill `out` with a view of the note stored at `index` (< db.count). */
+void cn_db_note_view(size_t index, cn_note_view *out)
+{
+    out->id = db.ids[index];
+    out->created_at = db.created_at[index];
+    out->modified_at = db.modified_at[index];
+    out->title = db.titles[index].str;
+    out->title_len = db.titles[index].len;
+    out->content = db.contents[index].str;
+    out->content_len = db.contents[index].len;
+    out->tags = db.tags[index].str;
+    out->tags_len = db.tags[index].len;
+    out->preview = db.previews[index].str;
+    out->preview_len = db.previews[index].len;
+}
+
+/* Free DB memory. The generation and journal length describe the files on
+ * disk, not this process's copy, so they survive a cleanup/init cycle. */
 void cn_db_cleanup(void)
 {
-    if (db.notes)
-    {
-        free(db.notes);
-        db.notes = NULL;
-    }
+    free(db.ids);
+    free(db.created_at);
+    free(db.modified_at);
+    free(db.titles);
+    free(db.tags);
+    free(db.previews);
+    free(db.contents);
+    cn_tags_clear(); /* walks db.tag_ids */
+    free(db.tag_ids);
+    db.ids = NULL;
+    db.created_at = NULL;
+    db.modified_at = NULL;
+    db.titles = NULL;
+    db.tags = NULL;
+    db.previews = NULL;
+    db.contents = NULL;
+    db.tag_ids = NULL;
+    cn_arena_free(&db.meta_text);
+    cn_arena_free(&db.content_text);
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (db.map_base)
+        munmap(db.map_base, db.map_len);
+#endif
+    cn_journal_close(&ro_journal);
+    cn_idmap_clear();
+    db.map_base = NULL;
+    db.map_len = 0;
+    db.readonly = 0;
     db.count = 0;
     db.capacity = 0;
     db.next_id = 1;
@@ -84,8 +84,21 @@ void cn_set_use_colors(int enabled)
     }
 }
 
+/* Called by cn_error_exit instead of exiting, if set (see serve.c) */
+static cn_error_handler error_handler;
+
+cn_error_handler cn_set_error_handler(cn_error_handler handler)
+{
+    cn_error_handler prev = error_handler;
+    error_handler = handler;
+    return prev;
+}
+
 /* Safety: prints error then exits. Colors optional.
- * This function intentionally does not return.
+ * This function intentionally does not return: a handler installed with
+ * cn_set_error_handler must not return either (serve and batch longjmp out).
+ * While such a handler is installed, only the main thread may call it: a
+ * longjmp cannot cross threads, so scan workers report failures instead.
  */
 void cn_error_exit(const char *msg)
 {
@@ -95,6 +108,8 @@ void cn_error_exit(const char *msg)
         fprintf(stderr, "%sError:%s %s\n", COLOR_RED, COLOR_RESET, msg);
     else
         fprintf(stderr, "Error: %s\n", msg);
+    if (error_handler)
+        error_handler();
     exit(EXIT_FAILURE);
 }
 
@@ -121,7 +136,7 @@ void cn_info_msg(const char *msg)
 /* Internal helpers for rendering without allocations */
 
 /* Print header line with box-drawing glyphs, title and optional tags/ID. */
-void cn_print_note_header(const cn_note *note, int show_id)
+void cn_print_note_header(const cn_note_view *note, int show_id)
 {
     if (!note)
         return;
@@ -154,7 +169,7 @@ void cn_print_note_header(const cn_note *note, int show_id)
 /* Print content lines without modifying the original buffer.
  * Splits on '\n' and prints each line with box glyphs.
  */
-void cn_print_note_content(const cn_note *note)
+void cn_print_note_content(const cn_note_view *note)
 {
     if (!note)
         return;
@@ -187,7 +202,7 @@ void cn_print_note_content(const cn_note *note)
 }
 
 /* Print created/modified timestamps. Uses localtime_r when available. */
-void cn_print_note_timestamps(const cn_note *note)
+void cn_print_note_timestamps(const cn_note_view *note)
 {
     if (!note)
         return;
@@ -239,7 +254,7 @@ void cn_print_note_footer(void)
 }
 
 /* Full note rendering */
-void cn_print_note_full(const cn_note *note, int show_id)
+void cn_print_note_full(const cn_note_view *note, int show_id)
 {
     if (!note)
         return;
@@ -250,8 +265,9 @@ void cn_print_note_full(const cn_note *note, int show_id)
     fputc('\n', stdout);
 }
 
-/* Compact rendering: title + first line of content */
-void cn_print_note_compact(const cn_note *note, int show_id)
+/* Compact rendering: title + the stored preview (first line of content),
+ * so listing never reads the content itself */
+void cn_print_note_compact(const cn_note_view *note, int show_id)
 {
     if (!note)
         return;
@@ -265,12 +281,8 @@ void cn_print_note_compact(const cn_note *note, int show_id)
             printf(" %s(%s)%s", COLOR_MAGENTA, note->tags, COLOR_RESET);
         fputc('\n', stdout);
 
-        if (note->content[0])
-        {
-            const char *nl = strchr(note->content, '\n');
-            size_t len = nl ? (size_t)(nl - note->content) : strlen(note->content);
-            printf("  %s%.*s%s\n", COLOR_DIM, (int)len, note->content, COLOR_RESET);
-        }
+        if (note->preview_len)
+            printf("  %s%s%s\n", COLOR_DIM, note->preview, COLOR_RESET);
     }
     else
     {
@@ -281,12 +293,8 @@ void cn_print_note_compact(const cn_note *note, int show_id)
             printf(" (%s)", note->tags);
         fputc('\n', stdout);
 
-        if (note->content[0])
-        {
-            const char *nl = strchr(note->content, '\n');
-            size_t len = nl ? (size_t)(nl - note->content) : strlen(note->content);
-            printf("  %.*s\n", (int)len, note->content);
-        }
+        if (note->preview_len)
+            printf("  %s\n", note->preview);
     }
 
     fputc('\n', stdout);
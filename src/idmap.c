@@ -0,0 +1,164 @@
+/*
+ * src/idmap.c
+ *
+ * Open-addressing hash from note id to its slot in the db columns,
+ * so edit, delete, journal replay and commits find a note in O(1) instead
+ * of scanning the array.
+ *
+ * - Linear probing over {id, slot} pairs; id 0 (never a valid note id)
+ *   marks an empty cell
+ * - Load factor kept at or below 1/2; the table doubles when it fills up
+ * - Deletion uses backward shifting, so there are no tombstones and probe
+ *   sequences never degrade over a long batch of deletes
+ *
+ * The map mirrors the global db: rebuilt after every load, cleared with the
+ * db, and updated by notes_io.c and the mapped journal replay whenever a
+ * note is appended or moved (cn_note_delete's swap-with-last).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cheatnote.h"
+#include "idmap.h"
+#include "db.h"
+#include "display.h"
+
+#define IDMAP_MIN_CAPACITY 64
+
+typedef struct
+{
+    uint32_t id; /* 0 = empty */
+    uint32_t slot;
+} idmap_cell;
+
+static struct
+{
+    idmap_cell *cells;
+    size_t mask; /* capacity - 1 */
+    size_t used;
+} map;
+
+static size_t home(uint32_t id)
+{
+    /* Ids are mostly sequential: scramble so runs do not cluster */
+    uint32_t h = id * 0x9E3779B1U;
+    return (size_t)(h ^ (h >> 15)) & map.mask;
+}
+
+static void alloc_cells(size_t capacity)
+{
+    map.cells = calloc(capacity, sizeof(*map.cells));
+    if (!map.cells)
+        cn_error_exit("Failed to allocate memory for database");
+    map.mask = capacity - 1;
+    map.used = 0;
+}
+
+/* Insert or update without growing */
+static void put_cell(uint32_t id, uint32_t slot)
+{
+    size_t i = home(id);
+    while (map.cells[i].id != 0 && map.cells[i].id != id)
+        i = (i + 1) & map.mask;
+    if (map.cells[i].id == 0)
+        map.used++;
+    map.cells[i].id = id;
+    map.cells[i].slot = slot;
+}
+
+static void grow(size_t want)
+{
+    size_t capacity = IDMAP_MIN_CAPACITY;
+    while (capacity < want * 2)
+        capacity *= 2;
+    if (map.cells && capacity <= map.mask + 1)
+        return;
+
+    idmap_cell *old = map.cells;
+    size_t old_capacity = old ? map.mask + 1 : 0;
+    alloc_cells(capacity);
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old[i].id != 0)
+            put_cell(old[i].id, old[i].slot);
+    }
+    free(old);
+}
+
+void cn_idmap_clear(void)
+{
+    free(map.cells);
+    map.cells = NULL;
+    map.mask = 0;
+    map.used = 0;
+}
+
+void cn_idmap_rebuild(void)
+{
+    cn_idmap_clear();
+    grow(db.count);
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        unsigned int id = cn_db_note_id(i);
+        if (id != 0)
+            put_cell(id, (uint32_t)i);
+    }
+}
+
+size_t cn_idmap_find(unsigned int id)
+{
+    if (!map.cells || id == 0)
+        return SIZE_MAX;
+
+    size_t i = home(id);
+    while (map.cells[i].id != 0)
+    {
+        if (map.cells[i].id == id)
+            return map.cells[i].slot;
+        i = (i + 1) & map.mask;
+    }
+    return SIZE_MAX;
+}
+
+void cn_idmap_set(unsigned int id, size_t slot)
+{
+    if (id == 0)
+        return;
+    grow(map.used + 1);
+    put_cell(id, (uint32_t)slot);
+}
+
+void cn_idmap_remove(unsigned int id)
+{
+    if (!map.cells || id == 0)
+        return;
+
+    size_t i = home(id);
+    while (map.cells[i].id != id)
+    {
+        if (map.cells[i].id == 0)
+            return; /* not present */
+        i = (i + 1) & map.mask;
+    }
+
+    /* Backward shift: pull later cells of the probe run into the hole when
+     * their home position does not lie cyclically within (hole, cell]. */
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & map.mask;
+        if (map.cells[j].id == 0)
+            break;
+        size_t k = home(map.cells[j].id);
+        int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays)
+        {
+            map.cells[i] = map.cells[j];
+            i = j;
+        }
+    }
+    map.cells[i].id = 0;
+    map.used--;
+}
@@ -0,0 +1,762 @@
+/*
+ * src/index.c
+ *
+ * Persistent inverted index for substring and token search.
+ *
+ * Two posting tables map hashed keys to ascending lists of note ids:
+ *   - trigram table: every 3-byte window of title, content and tags
+ *   - token table  : every maximal run of [A-Za-z0-9_]
+ * Keys are ASCII case-folded, matching the C-locale folding used by search.c,
+ * so one index serves case-sensitive and case-insensitive queries alike.
+ * Keys are hashed into a power-of-two number of buckets; collisions only add
+ * candidates, and every candidate is verified by the normal matcher.
+ *
+ * File layout ("<db>.idx", host byte order):
+ *
+ *   header       : magic "CNIX" | u32 version | u32 byte-order mark
+ *                  | u32 gram_shift | u32 token_shift | u32 reserved
+ *                  | u64 db_id | u64 generation | u64 journal_len
+ *                  | u64 gram_postings | u64 token_postings
+ *   gram_offsets : u32[(1 << gram_shift) + 1]
+ *   token_offsets: u32[(1 << token_shift) + 1]
+ *   gram_ids     : u32[gram_postings]
+ *   token_ids    : u32[token_postings]
+ *
+ * The index describes the database at (db_id, generation, journal_len);
+ * db_id (random per full save, see db.c) keeps an index left behind by a
+ * deleted database from passing for a new one at the same generation, so
+ * base files without one (pre-v6, or none yet) are scanned instead. Journal
+ * entries appended after journal_len, and notes touched in this process, are
+ * treated as "dirty" and always checked, so the index never has to be
+ * rewritten on add/edit/delete. It is rebuilt lazily on the next search once
+ * the base file is compacted or the dirty set grows too large.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "cheatnote.h"
+#include "index.h"
+#include "lock.h"
+#include "db.h"
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#define CN_INDEX_MAGIC "CNIX"
+#define CN_INDEX_VERSION 2u
+#define CN_INDEX_BYTE_ORDER_MARK 0x01020304u
+#define CN_INDEX_MIN_SHIFT 10
+#define CN_INDEX_MAX_SHIFT 22
+#define CN_INDEX_POSTINGS_PER_BUCKET 8
+#define CN_INDEX_MAX_IDS (1u << 28) /* candidate bitmap limit (32 MiB) */
+
+typedef struct cn_index_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t gram_shift;
+    uint32_t token_shift;
+    uint32_t reserved;
+    uint64_t db_id;
+    uint64_t generation;
+    uint64_t journal_len;
+    uint64_t gram_postings;
+    uint64_t token_postings;
+} cn_index_header;
+
+/* One posting table: offsets[b]..offsets[b+1] index into ids */
+typedef struct cn_posting_table
+{
+    uint32_t shift;
+    const uint32_t *offsets;
+    const uint32_t *ids;
+    uint64_t postings;
+} cn_posting_table;
+
+/* Process-wide index state (one database per process) */
+static struct
+{
+    int loaded;
+    uint64_t db_id;
+    uint64_t generation;
+    uint64_t journal_len;
+    cn_posting_table grams;
+    cn_posting_table tokens;
+    void *map_base; /* mapped file, or */
+    size_t map_len;
+    uint32_t *heap[4]; /* freshly built tables: gram/token offsets and ids */
+
+    unsigned int *dirty;
+    size_t dirty_count;
+    size_t dirty_cap;
+
+    unsigned char *candidates; /* bitmap over ids */
+    size_t candidate_bits;
+} idx;
+
+/* ------------------------------------------------------------
+ * Key extraction
+ * ------------------------------------------------------------*/
+
+static unsigned char fold(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static int is_word_byte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static uint32_t mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352dU;
+    h ^= h >> 15;
+    h *= 0x846ca68bU;
+    h ^= h >> 16;
+    return h;
+}
+
+/* Growable vector of key hashes */
+typedef struct hash_vec
+{
+    uint32_t *v;
+    size_t n;
+    size_t cap;
+} hash_vec;
+
+static int hv_push(hash_vec *hv, uint32_t h)
+{
+    if (hv->n == hv->cap)
+    {
+        size_t cap = hv->cap ? hv->cap * 2 : 256;
+        uint32_t *grown = realloc(hv->v, cap * sizeof(*grown));
+        if (!grown)
+            return 0;
+        hv->v = grown;
+        hv->cap = cap;
+    }
+    hv->v[hv->n++] = h;
+    return 1;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Sort and drop duplicates from hv->v[from..n) */
+static void hv_unique_tail(hash_vec *hv, size_t from)
+{
+    size_t n = hv->n - from;
+    if (n < 2)
+        return;
+    uint32_t *v = hv->v + from;
+    qsort(v, n, sizeof(*v), cmp_u32);
+    size_t w = 1;
+    for (size_t r = 1; r < n; ++r)
+    {
+        if (v[r] != v[w - 1])
+            v[w++] = v[r];
+    }
+    hv->n = from + w;
+}
+
+static int add_grams(hash_vec *hv, const char *s, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    for (size_t i = 0; i + 3 <= len; ++i)
+    {
+        uint32_t key = (uint32_t)fold(p[i]) | (uint32_t)fold(p[i + 1]) << 8 | (uint32_t)fold(p[i + 2]) << 16;
+        if (!hv_push(hv, mix32(key)))
+            return 0;
+    }
+    return 1;
+}
+
+static int add_tokens(hash_vec *hv, const char *s, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i = 0;
+    while (i < len)
+    {
+        while (i < len && !is_word_byte(p[i]))
+            ++i;
+        if (i >= len)
+            break;
+        uint32_t h = 2166136261u;
+        while (i < len && is_word_byte(p[i]))
+            h = (h ^ fold(p[i++])) * 16777619u;
+        if (!hv_push(hv, mix32(h)))
+            return 0;
+    }
+    return 1;
+}
+
+typedef int (*key_fn)(hash_vec *hv, const char *s, size_t len);
+
+static int add_note_keys(hash_vec *hv, key_fn fn, const cn_note_view *note)
+{
+    return fn(hv, note->title, note->title_len) &&
+           fn(hv, note->content, note->content_len) &&
+           fn(hv, note->tags, note->tags_len);
+}
+
+/* ------------------------------------------------------------
+ * Building
+ * ------------------------------------------------------------*/
+
+static uint32_t pick_shift(size_t postings)
+{
+    uint32_t shift = CN_INDEX_MIN_SHIFT;
+    while (shift < CN_INDEX_MAX_SHIFT &&
+           ((size_t)1 << shift) * CN_INDEX_POSTINGS_PER_BUCKET < postings)
+        ++shift;
+    return shift;
+}
+
+/* Slot order sorted by note id, so postings come out ascending */
+typedef struct id_slot
+{
+    unsigned int id;
+    size_t slot;
+} id_slot;
+
+static int cmp_id_slot(const void *a, const void *b)
+{
+    unsigned int x = ((const id_slot *)a)->id, y = ((const id_slot *)b)->id;
+    return (x > y) - (x < y);
+}
+
+/* Build one posting table from all notes. Returns 1 on success. */
+static int build_table(const id_slot *order, key_fn fn, cn_posting_table *out,
+                       uint32_t **offsets_out, uint32_t **ids_out)
+{
+    hash_vec keys = {0};
+    size_t *ends = malloc((db.count + 1) * sizeof(*ends));
+    if (!ends)
+        return 0;
+
+    /* pass 1: unique key hashes per note, concatenated */
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        cn_note_view note;
+        cn_db_note_view(order[i].slot, &note);
+        size_t from = keys.n;
+        if (!add_note_keys(&keys, fn, &note))
+            goto fail;
+        hv_unique_tail(&keys, from);
+        ends[i] = keys.n;
+    }
+    if (keys.n > UINT32_MAX)
+        goto fail;
+
+    /* pass 2: counting sort into buckets */
+    uint32_t shift = pick_shift(keys.n);
+    size_t buckets = (size_t)1 << shift;
+    uint32_t *offsets = calloc(buckets + 1, sizeof(*offsets));
+    uint32_t *ids = malloc((keys.n ? keys.n : 1) * sizeof(*ids));
+    if (!offsets || !ids)
+    {
+        free(offsets);
+        free(ids);
+        goto fail;
+    }
+
+    for (size_t k = 0; k < keys.n; ++k)
+        offsets[(keys.v[k] >> (32 - shift)) + 1]++;
+    for (size_t b = 0; b < buckets; ++b)
+        offsets[b + 1] += offsets[b];
+
+    uint32_t *fill = malloc(buckets * sizeof(*fill));
+    if (!fill)
+    {
+        free(offsets);
+        free(ids);
+        goto fail;
+    }
+    memcpy(fill, offsets, buckets * sizeof(*fill));
+
+    size_t k = 0;
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        for (; k < ends[i]; ++k)
+        {
+            uint32_t b = keys.v[k] >> (32 - shift);
+            /* distinct keys of one note can share a bucket */
+            if (fill[b] == offsets[b] || ids[fill[b] - 1] != order[i].id)
+                ids[fill[b]++] = order[i].id;
+        }
+    }
+
+    /* compact buckets that lost duplicate postings */
+    size_t w = 0;
+    for (size_t b = 0; b < buckets; ++b)
+    {
+        uint32_t start = offsets[b], end = fill[b];
+        offsets[b] = (uint32_t)w;
+        memmove(ids + w, ids + start, (size_t)(end - start) * sizeof(*ids));
+        w += end - start;
+    }
+    offsets[buckets] = (uint32_t)w;
+
+    free(fill);
+    free(ends);
+    free(keys.v);
+
+    out->shift = shift;
+    out->offsets = offsets;
+    out->ids = ids;
+    out->postings = w;
+    *offsets_out = offsets;
+    *ids_out = ids;
+    return 1;
+
+fail:
+    free(ends);
+    free(keys.v);
+    return 0;
+}
+
+static int index_path(char *out, size_t out_sz)
+{
+    const char *path = cn_get_db_path();
+    if (!path || !path[0])
+        return 0;
+    int r = snprintf(out, out_sz, "%s.idx", path);
+    return r > 0 && (size_t)r < out_sz;
+}
+
+static int write_table(FILE *f, const cn_posting_table *t, int ids)
+{
+    if (ids)
+        return t->postings == 0 || fwrite(t->ids, sizeof(uint32_t), t->postings, f) == t->postings;
+    size_t n = ((size_t)1 << t->shift) + 1;
+    return fwrite(t->offsets, sizeof(uint32_t), n, f) == n;
+}
+
+/* Persist the in-memory index atomically. Failure only costs a rebuild later. */
+static void save_index(void)
+{
+    char path[PATH_MAX], tmp[PATH_MAX + 16];
+    if (!index_path(path, sizeof(path)))
+        return;
+
+    /* Unique name: concurrent `list` runs may both rebuild the index */
+    FILE *f = cn_temp_open(path, tmp, sizeof(tmp));
+    if (!f)
+        return;
+
+    cn_index_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CN_INDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version = CN_INDEX_VERSION;
+    hdr.byte_order = CN_INDEX_BYTE_ORDER_MARK;
+    hdr.gram_shift = idx.grams.shift;
+    hdr.token_shift = idx.tokens.shift;
+    hdr.db_id = idx.db_id;
+    hdr.generation = idx.generation;
+    hdr.journal_len = idx.journal_len;
+    hdr.gram_postings = idx.grams.postings;
+    hdr.token_postings = idx.tokens.postings;
+
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             write_table(f, &idx.grams, 0) && write_table(f, &idx.tokens, 0) &&
+             write_table(f, &idx.grams, 1) && write_table(f, &idx.tokens, 1);
+    if (fclose(f) != 0)
+        ok = 0;
+    if (!ok || rename(tmp, path) != 0)
+        (void)remove(tmp);
+}
+
+static void release_tables(void)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (idx.map_base)
+        munmap(idx.map_base, idx.map_len);
+#endif
+    idx.map_base = NULL;
+    idx.map_len = 0;
+    for (size_t i = 0; i < sizeof(idx.heap) / sizeof(idx.heap[0]); ++i)
+    {
+        free(idx.heap[i]);
+        idx.heap[i] = NULL;
+    }
+    idx.loaded = 0;
+}
+
+static int rebuild(void)
+{
+    release_tables();
+    idx.dirty_count = 0;
+
+    id_slot *order = malloc((db.count ? db.count : 1) * sizeof(*order));
+    if (!order)
+        return 0;
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        order[i].id = cn_db_note_id(i);
+        order[i].slot = i;
+    }
+    qsort(order, db.count, sizeof(*order), cmp_id_slot);
+
+    int ok = build_table(order, add_grams, &idx.grams, &idx.heap[0], &idx.heap[2]) &&
+             build_table(order, add_tokens, &idx.tokens, &idx.heap[1], &idx.heap[3]);
+    free(order);
+    if (!ok)
+    {
+        release_tables();
+        return 0;
+    }
+
+    idx.db_id = db.db_id;
+    idx.generation = db.generation;
+    idx.journal_len = db.journal_len;
+    idx.loaded = 1;
+    save_index();
+    return 1;
+}
+
+/* ------------------------------------------------------------
+ * Loading
+ * ------------------------------------------------------------*/
+
+/* Bucket offsets must never decrease and end at the posting count, so
+ * bucket_list can trust them without bounds checks */
+static int offsets_ok(const cn_posting_table *t)
+{
+    size_t buckets = (size_t)1 << t->shift;
+    if (t->offsets[0] != 0 || t->offsets[buckets] != t->postings)
+        return 0;
+    for (size_t b = 0; b < buckets; ++b)
+    {
+        if (t->offsets[b + 1] < t->offsets[b])
+            return 0;
+    }
+    return 1;
+}
+
+static int map_index(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return 0;
+#else
+    char path[PATH_MAX];
+    if (!index_path(path, sizeof(path)))
+        return 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cn_index_header))
+    {
+        close(fd);
+        return 0;
+    }
+    size_t len = (size_t)st.st_size;
+    void *base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 0;
+
+    cn_index_header hdr;
+    memcpy(&hdr, base, sizeof(hdr));
+    if (memcmp(hdr.magic, CN_INDEX_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != CN_INDEX_VERSION || hdr.byte_order != CN_INDEX_BYTE_ORDER_MARK ||
+        hdr.gram_shift < CN_INDEX_MIN_SHIFT || hdr.gram_shift > CN_INDEX_MAX_SHIFT ||
+        hdr.token_shift < CN_INDEX_MIN_SHIFT || hdr.token_shift > CN_INDEX_MAX_SHIFT ||
+        hdr.db_id != db.db_id || hdr.generation != db.generation ||
+        hdr.journal_len > db.journal_len)
+        goto stale;
+
+    size_t gram_offs = ((size_t)1 << hdr.gram_shift) + 1;
+    size_t token_offs = ((size_t)1 << hdr.token_shift) + 1;
+    uint64_t words = (uint64_t)gram_offs + token_offs + hdr.gram_postings + hdr.token_postings;
+    if ((uint64_t)(len - sizeof(hdr)) != words * sizeof(uint32_t))
+        goto stale;
+
+    const uint32_t *w = (const uint32_t *)((const unsigned char *)base + sizeof(hdr));
+    idx.grams.shift = hdr.gram_shift;
+    idx.grams.offsets = w;
+    idx.tokens.shift = hdr.token_shift;
+    idx.tokens.offsets = w + gram_offs;
+    idx.grams.ids = w + gram_offs + token_offs;
+    idx.grams.postings = hdr.gram_postings;
+    idx.tokens.ids = idx.grams.ids + hdr.gram_postings;
+    idx.tokens.postings = hdr.token_postings;
+    if (!offsets_ok(&idx.grams) || !offsets_ok(&idx.tokens))
+        goto stale;
+
+    idx.map_base = base;
+    idx.map_len = len;
+    idx.db_id = hdr.db_id;
+    idx.generation = hdr.generation;
+    idx.journal_len = hdr.journal_len;
+    idx.loaded = 1;
+    return 1;
+
+stale:
+    munmap(base, len);
+    return 0;
+#endif
+}
+
+static void mark_dirty(unsigned int id)
+{
+    if (idx.dirty_count == idx.dirty_cap)
+    {
+        size_t cap = idx.dirty_cap ? idx.dirty_cap * 2 : 64;
+        unsigned int *grown = realloc(idx.dirty, cap * sizeof(*grown));
+        if (!grown)
+        {
+            /* cannot track it: force a rebuild on the next lookup */
+            idx.loaded = 0;
+            return;
+        }
+        idx.dirty = grown;
+        idx.dirty_cap = cap;
+    }
+    idx.dirty[idx.dirty_count++] = id;
+}
+
+/* Notes changed by journal entries the index does not cover yet */
+static void collect_journal_dirty(void)
+{
+    if (idx.journal_len >= db.journal_len)
+        return;
+    cn_journal j;
+    if (!cn_journal_open(&j, cn_get_db_path(), db.generation))
+        return;
+    cn_journal_entry e;
+    size_t start = j.pos;
+    while (cn_journal_next(&j, &e))
+    {
+        if (start >= idx.journal_len)
+            mark_dirty(e.id);
+        start = j.pos;
+    }
+    cn_journal_close(&j);
+}
+
+/* ------------------------------------------------------------
+ * Querying
+ * ------------------------------------------------------------*/
+
+typedef struct posting_list
+{
+    const uint32_t *ids;
+    size_t n;
+} posting_list;
+
+static int cmp_list_len(const void *a, const void *b)
+{
+    size_t x = ((const posting_list *)a)->n, y = ((const posting_list *)b)->n;
+    return (x > y) - (x < y);
+}
+
+/* Intersect sorted lists; result written to out (capacity >= shortest list) */
+static size_t intersect(posting_list *lists, size_t nlists, uint32_t *out)
+{
+    qsort(lists, nlists, sizeof(*lists), cmp_list_len);
+    size_t n = lists[0].n;
+    memcpy(out, lists[0].ids, n * sizeof(*out));
+
+    for (size_t l = 1; l < nlists && n > 0; ++l)
+    {
+        const uint32_t *ids = lists[l].ids;
+        size_t m = lists[l].n, j = 0, w = 0;
+        for (size_t i = 0; i < n && j < m; ++i)
+        {
+            /* gallop through the (longer) list */
+            size_t step = 1;
+            while (j + step < m && ids[j + step] < out[i])
+                step <<= 1;
+            size_t lo = j, hi = (j + step < m) ? j + step : m - 1;
+            while (lo < hi)
+            {
+                size_t mid = lo + (hi - lo) / 2;
+                if (ids[mid] < out[i])
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            j = lo;
+            if (ids[j] == out[i])
+                out[w++] = out[i];
+        }
+        n = w;
+    }
+    return n;
+}
+
+static posting_list bucket_list(const cn_posting_table *t, uint32_t h)
+{
+    uint32_t b = h >> (32 - t->shift);
+    posting_list pl = {t->ids + t->offsets[b], (size_t)(t->offsets[b + 1] - t->offsets[b])};
+    return pl;
+}
+
+/* Which posting tables can answer opts; 0 if none */
+static int plan_query(const cn_search_opts *opts, int *use_grams, int *use_tokens)
+{
+    size_t len = strlen(opts->pattern);
+    *use_grams = 0;
+    *use_tokens = 0;
+
+    if (opts->regex_mode)
+    {
+        /* only a plain literal word wrapped in \b...\b is a token lookup */
+        if (!opts->word_boundary || len == 0)
+            return 0;
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (!is_word_byte((unsigned char)opts->pattern[i]))
+                return 0;
+        }
+        *use_tokens = 1;
+        return 1;
+    }
+
+    *use_grams = len >= 3;
+    if (opts->exact_match)
+    {
+        /* a field equal to the pattern contains every token of the pattern */
+        for (size_t i = 0; i < len && !*use_tokens; ++i)
+            *use_tokens = is_word_byte((unsigned char)opts->pattern[i]);
+    }
+    return *use_grams || *use_tokens;
+}
+
+int cn_index_lookup(const cn_search_opts *opts)
+{
+    free(idx.candidates);
+    idx.candidates = NULL;
+    idx.candidate_bits = 0;
+
+    if (!opts || !opts->pattern || !opts->pattern[0] || db.next_id > CN_INDEX_MAX_IDS ||
+        db.db_id == 0)
+        return 0;
+
+    /* Batched changes not saved yet are in neither the index nor the
+     * journal it checks for dirty notes */
+    if (cn_db_commits_pending())
+        return 0;
+
+    int use_grams, use_tokens;
+    if (!plan_query(opts, &use_grams, &use_tokens))
+        return 0;
+
+    if (!idx.loaded)
+    {
+        idx.dirty_count = 0;
+        if (map_index())
+            collect_journal_dirty();
+    }
+    if (!idx.loaded || idx.dirty_count > 4096 + db.count / 8)
+    {
+        if (!rebuild())
+            return 0;
+    }
+
+    /* gather posting lists for every key of the pattern */
+    hash_vec keys = {0};
+    size_t len = strlen(opts->pattern);
+    if (use_grams && !add_grams(&keys, opts->pattern, len))
+    {
+        free(keys.v);
+        return 0;
+    }
+    size_t ngrams = keys.n; /* keys[0..ngrams) are trigrams, the rest tokens */
+    if (use_tokens && !add_tokens(&keys, opts->pattern, len))
+    {
+        free(keys.v);
+        return 0;
+    }
+
+    posting_list *lists = malloc((keys.n ? keys.n : 1) * sizeof(*lists));
+    if (!lists)
+    {
+        free(keys.v);
+        return 0;
+    }
+    for (size_t k = 0; k < keys.n; ++k)
+        lists[k] = bucket_list(k < ngrams ? &idx.grams : &idx.tokens, keys.v[k]);
+    free(keys.v);
+
+    size_t shortest = lists[0].n;
+    for (size_t k = 1; k < keys.n; ++k)
+        if (lists[k].n < shortest)
+            shortest = lists[k].n;
+
+    uint32_t *ids = malloc((shortest ? shortest : 1) * sizeof(*ids));
+    idx.candidate_bits = (size_t)db.next_id + 1;
+    idx.candidates = calloc((idx.candidate_bits + 7) / 8, 1);
+    if (!ids || !idx.candidates)
+    {
+        free(ids);
+        free(lists);
+        free(idx.candidates);
+        idx.candidates = NULL;
+        return 0;
+    }
+
+    size_t n = intersect(lists, keys.n, ids);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (ids[i] < idx.candidate_bits)
+            idx.candidates[ids[i] >> 3] |= (unsigned char)(1u << (ids[i] & 7));
+    }
+    for (size_t i = 0; i < idx.dirty_count; ++i)
+    {
+        unsigned int id = idx.dirty[i];
+        if (id < idx.candidate_bits)
+            idx.candidates[id >> 3] |= (unsigned char)(1u << (id & 7));
+    }
+
+    free(ids);
+    free(lists);
+    return 1;
+}
+
+int cn_index_is_candidate(unsigned int id)
+{
+    if (!idx.candidates)
+        return 1;
+    return id < idx.candidate_bits && (idx.candidates[id >> 3] & (1u << (id & 7)));
+}
+
+void cn_index_touch(unsigned int id)
+{
+    if (idx.loaded)
+        mark_dirty(id);
+}
+
+void cn_index_close(void)
+{
+    release_tables();
+    free(idx.dirty);
+    idx.dirty = NULL;
+    idx.dirty_count = 0;
+    idx.dirty_cap = 0;
+    free(idx.candidates);
+    idx.candidates = NULL;
+    idx.candidate_bits = 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * src/journal.c
+ *
+ * Append-only write-ahead log for CheatNote.
+ *
+ * add/edit/delete append one small entry here instead of rewriting the
+ * whole database; cn_db_load replays the entries on top of the base file
+ * and cn_db_save folds them in (compaction) and removes the journal.
+ *
+ * File layout (host byte order, like the database itself):
+ *
+ *   header : magic "CNWL" | u32 version | u32 byte-order mark | u32 reserved
+ *            | u64 base_generation
+ *   entry  : u32 op | u32 id | i64 timestamp | u32 payload_len | u32 checksum
+ *            | payload bytes
+ *
+ * base_generation ties the journal to one version of the base file, so a
+ * journal left behind by an interrupted compaction is ignored instead of
+ * being replayed twice. Every entry carries an FNV-1a checksum; replay stops
+ * at the first torn or corrupted entry and the next append truncates it.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "cheatnote.h"
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#define CN_JOURNAL_MAGIC "CNWL"
+#define CN_JOURNAL_VERSION 1u
+#define CN_JOURNAL_BYTE_ORDER_MARK 0x01020304u
+
+typedef struct cn_journal_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t reserved;
+    uint64_t base_generation;
+} cn_journal_header;
+
+typedef struct cn_journal_frame
+{
+    uint32_t op;
+    uint32_t id;
+    int64_t timestamp;
+    uint32_t payload_len;
+    uint32_t checksum;
+} cn_journal_frame;
+
+/* FNV-1a over the frame (checksum field excluded) and the payload */
+static uint32_t frame_checksum(const cn_journal_frame *fr, const void *payload)
+{
+    uint32_t h = 2166136261u;
+    const unsigned char *p = (const unsigned char *)fr;
+    for (size_t i = 0; i < offsetof(cn_journal_frame, checksum); ++i)
+        h = (h ^ p[i]) * 16777619u;
+    p = payload;
+    for (size_t i = 0; i < fr->payload_len; ++i)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+int cn_journal_path(const char *db_path, char *out, size_t out_sz)
+{
+    if (!db_path || !out || out_sz == 0)
+        return 0;
+    int r = snprintf(out, out_sz, "%s.wal", db_path);
+    return r > 0 && (size_t)r < out_sz;
+}
+
+/* Length of the intact prefix: header plus every entry whose frame and
+ * checksum are complete. Returns 0 if the header itself is unusable. */
+static size_t scan_valid_len(const unsigned char *base, size_t len, uint64_t base_generation)
+{
+    cn_journal_header hdr;
+    if (len < sizeof(hdr))
+        return 0;
+    memcpy(&hdr, base, sizeof(hdr));
+    if (memcmp(hdr.magic, CN_JOURNAL_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != CN_JOURNAL_VERSION || hdr.byte_order != CN_JOURNAL_BYTE_ORDER_MARK ||
+        hdr.base_generation != base_generation)
+        return 0;
+
+    size_t off = sizeof(hdr);
+    while (len - off >= sizeof(cn_journal_frame))
+    {
+        cn_journal_frame fr;
+        memcpy(&fr, base + off, sizeof(fr));
+        if (len - off - sizeof(fr) < fr.payload_len)
+            break;
+        if (frame_checksum(&fr, base + off + sizeof(fr)) != fr.checksum)
+            break;
+        off += sizeof(fr) + fr.payload_len;
+    }
+    return off;
+}
+
+int cn_journal_open(cn_journal *j, const char *db_path, uint64_t base_generation)
+{
+    char path[PATH_MAX];
+    memset(j, 0, sizeof(*j));
+    if (!cn_journal_path(db_path, path, sizeof(path)))
+        return 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    struct stat st;
+    if (fstat(_fileno(f), &st) != 0 || st.st_size <= 0)
+    {
+        fclose(f);
+        return 0;
+    }
+    j->len = (size_t)st.st_size;
+    j->base = malloc(j->len);
+    if (!j->base || fread(j->base, 1, j->len, f) != j->len)
+    {
+        fclose(f);
+        cn_journal_close(j);
+        return 0;
+    }
+    fclose(f);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return 0;
+    }
+    j->len = (size_t)st.st_size;
+    void *base = mmap(NULL, j->len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        j->len = 0;
+        return 0;
+    }
+    j->base = base;
+    j->mapped = 1;
+#endif
+
+    j->valid_len = scan_valid_len(j->base, j->len, base_generation);
+    if (j->valid_len == 0)
+    {
+        cn_journal_close(j);
+        return 0;
+    }
+    j->pos = sizeof(cn_journal_header);
+    return 1;
+}
+
+int cn_journal_next(cn_journal *j, cn_journal_entry *out)
+{
+    if (!j->base || j->pos >= j->valid_len)
+        return 0;
+
+    cn_journal_frame fr;
+    memcpy(&fr, j->base + j->pos, sizeof(fr));
+    out->op = fr.op;
+    out->id = fr.id;
+    out->timestamp = (time_t)fr.timestamp;
+    out->payload = j->base + j->pos + sizeof(fr);
+    out->payload_len = fr.payload_len;
+    j->pos += sizeof(fr) + fr.payload_len;
+    return 1;
+}
+
+void cn_journal_close(cn_journal *j)
+{
+    if (!j->base)
+        return;
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (j->mapped)
+        munmap(j->base, j->len);
+    else
+#endif
+        free(j->base);
+    memset(j, 0, sizeof(*j));
+}
+
+size_t cn_journal_append(const char *db_path, uint64_t base_generation, size_t valid_len,
+                         uint32_t op, unsigned int id, time_t timestamp,
+                         const void *payload, size_t payload_len)
+{
+    char path[PATH_MAX];
+    if (!cn_journal_path(db_path, path, sizeof(path)) || payload_len > UINT32_MAX)
+        return 0;
+
+    /* Build header (for a new journal) + frame + payload so a single write
+     * lands the whole entry. */
+    cn_journal_header hdr;
+    size_t hdr_len = 0;
+    if (valid_len == 0)
+    {
+        memcpy(hdr.magic, CN_JOURNAL_MAGIC, sizeof(hdr.magic));
+        hdr.version = CN_JOURNAL_VERSION;
+        hdr.byte_order = CN_JOURNAL_BYTE_ORDER_MARK;
+        hdr.reserved = 0;
+        hdr.base_generation = base_generation;
+        hdr_len = sizeof(hdr);
+    }
+
+    cn_journal_frame fr;
+    fr.op = op;
+    fr.id = id;
+    fr.timestamp = (int64_t)timestamp;
+    fr.payload_len = (uint32_t)payload_len;
+    fr.checksum = frame_checksum(&fr, payload);
+
+    size_t total = hdr_len + sizeof(fr) + payload_len;
+    unsigned char *buf = malloc(total);
+    if (!buf)
+        return 0;
+    if (hdr_len)
+        memcpy(buf, &hdr, hdr_len);
+    memcpy(buf + hdr_len, &fr, sizeof(fr));
+    if (payload_len)
+        memcpy(buf + hdr_len + sizeof(fr), payload, payload_len);
+
+    size_t new_len = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    FILE *f = fopen(path, valid_len == 0 ? "wb" : "r+b");
+    if (f && fseek(f, (long)valid_len, SEEK_SET) == 0 &&
+        fwrite(buf, 1, total, f) == total && fflush(f) == 0 &&
+        _chsize(_fileno(f), (long)(valid_len + total)) == 0 && _commit(_fileno(f)) == 0)
+        new_len = valid_len + total;
+    if (f)
+        fclose(f);
+#else
+    int fd = open(path, O_WRONLY | O_CREAT | (valid_len == 0 ? O_TRUNC : 0), 0600);
+    if (fd >= 0)
+    {
+        /* drop any torn tail left by a crashed writer */
+        if (ftruncate(fd, (off_t)valid_len) == 0 && lseek(fd, (off_t)valid_len, SEEK_SET) >= 0)
+        {
+            size_t done = 0;
+            while (done < total)
+            {
+                ssize_t w = write(fd, buf + done, total - done);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w <= 0)
+                    break;
+                done += (size_t)w;
+            }
+            if (done == total && fsync(fd) == 0)
+                new_len = valid_len + total;
+        }
+        close(fd);
+    }
+#endif
+
+    free(buf);
+    return new_len;
+}
+
+void cn_journal_remove(const char *db_path)
+{
+    char path[PATH_MAX];
+    if (cn_journal_path(db_path, path, sizeof(path)))
+        (void)remove(path);
+}
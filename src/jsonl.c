@@ -0,0 +1,429 @@
+/*
+ * src/jsonl.c
+ *
+ * Streaming JSON Lines reader used by `import --format=jsonl`.
+ *
+ * - One JSON object per line. JSON strings cannot contain a raw newline,
+ *   so records are found with memchr alone; the file is read in
+ *   CN_JSONL_BLOCK_SIZE chunks and a partial last line is moved to the
+ *   front of the buffer before the next read, as in csv.c.
+ * - Objects are parsed where they lie: string values are unescaped in
+ *   place (an escape never expands: \uXXXX is six bytes and at most three
+ *   in UTF-8, a surrogate pair twelve bytes and four in UTF-8) and
+ *   NUL-terminated inside the buffer. Clean spans between escapes are
+ *   found with strpbrk and moved in bulk.
+ * - Known members: id, title, content, tags, created, modified (import
+ *   keeps the timestamps, and the id when replacing the database). Unknown
+ *   members of any type are skipped, so objects from other tools import.
+ * - A line that is not a well-formed object is reported as invalid and
+ *   skipped; the rest of the file is still read.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "jsonl.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int cn_jsonl_open(cn_jsonl_reader *r, FILE *f, size_t max_record)
+{
+    memset(r, 0, sizeof(*r));
+    r->f = f;
+    r->max_record = max_record;
+    /* Room for a full block after the largest partial line, plus a NUL */
+    r->cap = CN_JSONL_BLOCK_SIZE + max_record + 2;
+    r->buf = malloc(r->cap);
+    return r->buf != NULL;
+}
+
+void cn_jsonl_close(cn_jsonl_reader *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+    r->start = r->end = r->cap = 0;
+}
+
+/* Move the unconsumed tail to the front and read another block.
+ * Returns the number of bytes read (0 at end of file or on error). */
+static size_t refill(cn_jsonl_reader *r)
+{
+    if (r->eof)
+        return 0;
+    if (r->start > 0)
+    {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->scan -= r->start;
+        r->start = 0;
+    }
+    size_t n = fread(r->buf + r->end, 1, r->cap - 1 - r->end, r->f);
+    if (n == 0)
+        r->eof = 1;
+    r->end += n;
+    return n;
+}
+
+/* ------------ In-place object parser -------------- */
+
+static char *skip_ws(char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        ++p;
+    return p;
+}
+
+static int hex4(const char *p, unsigned *out)
+{
+    unsigned v = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9')
+            v |= (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            v |= (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            v |= (unsigned)(c - 'A' + 10);
+        else
+            return 0;
+    }
+    *out = v;
+    return 1;
+}
+
+static char *put_utf8(char *w, unsigned cp)
+{
+    if (cp < 0x80)
+    {
+        *w++ = (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        *w++ = (char)(0xC0 | (cp >> 6));
+        *w++ = (char)(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        *w++ = (char)(0xE0 | (cp >> 12));
+        *w++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *w++ = (char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        *w++ = (char)(0xF0 | (cp >> 18));
+        *w++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+        *w++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+        *w++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return w;
+}
+
+/* Unescape the string starting at the quote *pp, writing at *wp (which
+ * never runs ahead of the read position). Advances both; 0 on bad input. */
+static int parse_string(char **pp, char **wp)
+{
+    char *p = *pp + 1, *w = *wp;
+    for (;;)
+    {
+        char *stop = strpbrk(p, "\"\\");
+        if (!stop)
+            return 0; /* unterminated */
+        size_t span = (size_t)(stop - p);
+        if (w != p)
+            memmove(w, p, span);
+        w += span;
+        p = stop;
+
+        if (*p == '"')
+        {
+            *pp = p + 1;
+            *wp = w;
+            return 1;
+        }
+
+        unsigned cp;
+        switch (p[1])
+        {
+        case '"': *w++ = '"'; break;
+        case '\\': *w++ = '\\'; break;
+        case '/': *w++ = '/'; break;
+        case 'b': *w++ = '\b'; break;
+        case 'f': *w++ = '\f'; break;
+        case 'n': *w++ = '\n'; break;
+        case 'r': *w++ = '\r'; break;
+        case 't': *w++ = '\t'; break;
+        case 'u':
+            if (!hex4(p + 2, &cp))
+                return 0;
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                unsigned lo;
+                if (p[6] == '\\' && p[7] == 'u' && hex4(p + 8, &lo) && lo >= 0xDC00 && lo <= 0xDFFF)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    p += 6;
+                }
+                else
+                {
+                    cp = 0xFFFD; /* lone surrogate */
+                }
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF)
+            {
+                cp = 0xFFFD;
+            }
+            w = put_utf8(w, cp);
+            p += 4;
+            break;
+        default:
+            return 0;
+        }
+        p += 2;
+    }
+}
+
+/* Skip any JSON value at p. Returns the byte after it, NULL on bad input */
+static char *skip_value(char *p)
+{
+    if (*p == '"')
+    {
+        char *w = p;
+        return parse_string(&p, &w) ? p : NULL;
+    }
+    if (*p == '{' || *p == '[')
+    {
+        int depth = 0;
+        while (*p)
+        {
+            if (*p == '"')
+            {
+                char *w = p;
+                if (!parse_string(&p, &w))
+                    return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[')
+                ++depth;
+            else if ((*p == '}' || *p == ']') && --depth == 0)
+                return p + 1;
+            ++p;
+        }
+        return NULL;
+    }
+    /* number, true, false, null */
+    char *start = p;
+    while (*p && !strchr(",}] \t\r\n", *p))
+        ++p;
+    return p > start ? p : NULL;
+}
+
+/* String or null member. The result is NUL-terminated in place. */
+static char *parse_text(char *p, char **out, size_t *len)
+{
+    static char empty[1];
+    if (strncmp(p, "null", 4) == 0)
+    {
+        *out = empty;
+        *len = 0;
+        return p + 4;
+    }
+    if (*p != '"')
+        return NULL;
+    char *w = p + 1;
+    *out = w;
+    if (!parse_string(&p, &w))
+        return NULL;
+    *len = (size_t)(w - *out);
+    *w = '\0'; /* at most overwrites the closing quote */
+    return p;
+}
+
+/* Tags: a string, null, or an array of strings joined with ',' */
+static char *parse_tags(char *p, char **out, size_t *len)
+{
+    if (*p != '[')
+        return parse_text(p, out, len);
+
+    char *w = p; /* the '[' and each element's quotes leave room for the commas */
+    *out = w;
+    p = skip_ws(p + 1);
+    if (*p == ']')
+        p++;
+    else
+    {
+        for (;;)
+        {
+            if (*p != '"')
+                return NULL;
+            char *elem = w;
+            if (w > *out)
+                *w++ = ',';
+            char *text = w;
+            if (!parse_string(&p, &w))
+                return NULL;
+            if (w == text)
+                w = elem; /* drop empty tags */
+            p = skip_ws(p);
+            if (*p == ']')
+            {
+                ++p;
+                break;
+            }
+            if (*p != ',')
+                return NULL;
+            p = skip_ws(p + 1);
+        }
+    }
+    *len = (size_t)(w - *out);
+    *w = '\0';
+    return p;
+}
+
+static char *parse_int(char *p, long long *out)
+{
+    char *end;
+    long long v = strtoll(p, &end, 10);
+    if (end == p)
+        return skip_value(p); /* null or a non-integer: treat as absent */
+    if (*end == '.' || *end == 'e' || *end == 'E')
+        end = skip_value(end); /* fractional seconds are dropped */
+    *out = v;
+    return end;
+}
+
+static int parse_object(char *p, cn_jsonl_note *note)
+{
+    static char empty[1];
+    memset(note, 0, sizeof(*note));
+    note->title = note->content = note->tags = empty;
+
+    p = skip_ws(p);
+    if (*p != '{')
+        return 0;
+    p = skip_ws(p + 1);
+    if (*p == '}')
+        return *skip_ws(p + 1) == '\0';
+
+    for (;;)
+    {
+        if (*p != '"')
+            return 0;
+        char *key = p + 1, *w = key;
+        if (!parse_string(&p, &w))
+            return 0;
+        *w = '\0';
+        p = skip_ws(p);
+        if (*p != ':')
+            return 0;
+        p = skip_ws(p + 1);
+
+        if (strcmp(key, "title") == 0)
+            p = parse_text(p, &note->title, &note->title_len);
+        else if (strcmp(key, "content") == 0)
+            p = parse_text(p, &note->content, &note->content_len);
+        else if (strcmp(key, "tags") == 0)
+            p = parse_tags(p, &note->tags, &note->tags_len);
+        else if (strcmp(key, "id") == 0)
+            p = parse_int(p, &note->id);
+        else if (strcmp(key, "created") == 0)
+            p = parse_int(p, &note->created);
+        else if (strcmp(key, "modified") == 0)
+            p = parse_int(p, &note->modified);
+        else
+            p = skip_value(p);
+        if (!p)
+            return 0;
+
+        p = skip_ws(p);
+        if (*p == ',')
+        {
+            p = skip_ws(p + 1);
+            continue;
+        }
+        if (*p == '}')
+            return *skip_ws(p + 1) == '\0';
+        return 0;
+    }
+}
+
+/* ------------ Record loop -------------- */
+
+int cn_jsonl_next(cn_jsonl_reader *r, cn_jsonl_note *note)
+{
+    for (;;)
+    {
+        char *nl = memchr(r->buf + r->scan, '\n', r->end - r->scan);
+        char *rec = r->buf + r->start;
+        size_t len;
+
+        if (nl)
+        {
+            len = (size_t)(nl - rec);
+            r->start = (size_t)(nl - r->buf) + 1;
+        }
+        else if (r->end - r->start > r->max_record)
+        {
+            /* Overlong: drop everything up to the next newline */
+            r->line++;
+            for (;;)
+            {
+                r->start = r->scan = r->end = 0;
+                if (refill(r) == 0)
+                    return CN_JSONL_OVERLONG;
+                nl = memchr(r->buf, '\n', r->end);
+                if (nl)
+                {
+                    r->start = r->scan = (size_t)(nl - r->buf) + 1;
+                    return CN_JSONL_OVERLONG;
+                }
+            }
+        }
+        else
+        {
+            r->scan = r->end;
+            if (!r->eof && refill(r) > 0)
+                continue;
+            if (r->end == r->start)
+                return CN_JSONL_END;
+            /* Last line without a trailing newline */
+            len = r->end - r->start;
+            r->start = r->end;
+        }
+        r->scan = r->start;
+        r->line++;
+
+        if (len > r->max_record)
+            return CN_JSONL_OVERLONG;
+        rec[len] = '\0';
+
+        char *p = rec;
+        p = skip_ws(p);
+        if (*p == '\0')
+            continue; /* blank line */
+
+        return parse_object(p, note) ? CN_JSONL_RECORD : CN_JSONL_INVALID;
+    }
+}
+
+size_t cn_jsonl_estimate_records(cn_jsonl_reader *r)
+{
+    if (r->end == r->start)
+        refill(r);
+
+    size_t buffered = r->end - r->start, lines = 0;
+    for (const char *p = r->buf + r->start, *e = r->buf + r->end;
+         (p = memchr(p, '\n', (size_t)(e - p))) != NULL; ++p)
+        ++lines;
+    if (buffered == 0)
+        return 0;
+
+    struct stat st;
+    if (r->eof || fstat(fileno(r->f), &st) != 0 || (size_t)st.st_size <= buffered)
+        return lines + 1;
+    return (size_t)((double)lines * (double)st.st_size / (double)buffered) + 1;
+}
@@ -0,0 +1,190 @@
+/*
+ * src/lock.c
+ *
+ * Cross-process coordination for the database files.
+ *
+ * - An advisory flock(2) on "<db>.lock" guards the base file and journal.
+ *   The database file itself cannot carry the lock: every compaction
+ *   renames a new inode into place. Readers (cn_db_open_readonly, the read
+ *   half of cn_db_load) take it shared just long enough to map the base
+ *   file and journal consistently, so any number of them run at once.
+ *   Writers take it exclusive only around the commit itself (see db.c for
+ *   the check-and-merge done under it) or, for bulk rewrites such as
+ *   `import`, for the whole command.
+ * - Waiting uses non-blocking attempts with exponential backoff (1 ms up
+ *   to 64 ms), so a stuck process turns into an error after
+ *   CN_LOCK_TIMEOUT_MS instead of a hang.
+ * - The lock is best effort: if the lock file cannot be created (missing
+ *   directory, read-only media) commands proceed unlocked, as before.
+ * - Temporary files for atomic replacement get unique names from mkstemp,
+ *   so concurrent writers never write through the same "<path>.tmp", and
+ *   the permissions of the file they replace.
+ *
+ * On Windows locking is a no-op and temp files keep the fixed name.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE /* flock, mkstemp */
+#endif
+
+#include "cheatnote.h"
+#include "lock.h"
+#include "db.h"
+#include "display.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
+
+static int lock_fd = -1;
+static int held = CN_LOCK_NONE;
+static char lock_path[PATH_MAX + 8];
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+static long elapsed_ms(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)(now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+/* Open "<db>.lock" for the current database path. Returns 0 if unusable. */
+static int open_lock_file(void)
+{
+    const char *path = cn_get_db_path();
+    char want[PATH_MAX + 8];
+    if (!path || path[0] == '\0')
+        return 0;
+    int n = snprintf(want, sizeof(want), "%s.lock", path);
+    if (n < 0 || (size_t)n >= sizeof(want))
+        return 0;
+
+    if (lock_fd >= 0 && strcmp(want, lock_path) == 0)
+        return 1;
+    if (lock_fd >= 0)
+    {
+        close(lock_fd); /* the database path changed: drop the old lock */
+        lock_fd = -1;
+        held = CN_LOCK_NONE;
+    }
+
+    lock_fd = open(want, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd < 0)
+        return 0;
+    memcpy(lock_path, want, (size_t)n + 1);
+    return 1;
+}
+
+int cn_db_lock(int mode)
+{
+    int prev = held;
+    if (held >= mode)
+        return prev;
+    if (!open_lock_file())
+    {
+        held = mode; /* best effort: proceed unlocked */
+        return prev;
+    }
+
+    int op = (mode == CN_LOCK_EXCLUSIVE ? LOCK_EX : LOCK_SH) | LOCK_NB;
+    struct timespec start, pause = {0, 1000000};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (flock(lock_fd, op) != 0)
+    {
+        if (errno != EWOULDBLOCK && errno != EINTR)
+        {
+            held = mode; /* e.g. unsupported by the filesystem */
+            return prev;
+        }
+        if (elapsed_ms(&start) >= CN_LOCK_TIMEOUT_MS)
+            cn_error_exit("Database is locked by another process");
+        nanosleep(&pause, NULL);
+        if (pause.tv_nsec < 64000000)
+            pause.tv_nsec *= 2;
+    }
+    held = mode;
+    return prev;
+}
+
+void cn_db_lock_restore(int mode)
+{
+    if (mode >= held)
+        return;
+    if (lock_fd >= 0)
+        (void)flock(lock_fd, mode == CN_LOCK_NONE ? LOCK_UN : LOCK_SH);
+    held = mode;
+}
+
+FILE *cn_temp_open(const char *path, char *tmp, size_t tmp_sz)
+{
+    int n = snprintf(tmp, tmp_sz, "%s.tmp.XXXXXX", path);
+    if (n < 0 || (size_t)n >= tmp_sz)
+        return NULL;
+    int fd = mkstemp(tmp);
+    if (fd < 0)
+        return NULL;
+
+    /* mkstemp creates 0600 and rename keeps it: give the replacement the
+     * mode of the file it replaces, or the usual 0666 & ~umask if new */
+    struct stat st;
+    mode_t mode;
+    if (stat(path, &st) == 0)
+    {
+        mode = st.st_mode & 07777;
+    }
+    else
+    {
+        mode_t mask = umask(0);
+        umask(mask);
+        mode = 0666 & ~mask;
+    }
+    (void)fchmod(fd, mode);
+    FILE *f = fdopen(fd, "wb");
+    if (!f)
+    {
+        close(fd);
+        (void)remove(tmp);
+    }
+    return f;
+}
+
+#else /* Windows: no advisory locking */
+
+int cn_db_lock(int mode)
+{
+    int prev = held;
+    if (mode > held)
+        held = mode;
+    (void)lock_fd;
+    (void)lock_path;
+    return prev;
+}
+
+void cn_db_lock_restore(int mode)
+{
+    if (mode < held)
+        held = mode;
+}
+
+FILE *cn_temp_open(const char *path, char *tmp, size_t tmp_sz)
+{
+    int n = snprintf(tmp, tmp_sz, "%s.tmp", path);
+    if (n < 0 || (size_t)n >= tmp_sz)
+        return NULL;
+    return fopen(tmp, "wb");
+}
+
+#endif
@@ -3,8 +3,9 @@
  *
  * Entry point for CheatNote CLI.
  * - Defines global storage for the DB and runtime options (single-definition).
- * - Handles global flags (currently: --no-color).
- * - Initializes DB, registers cleanup, and dispatches commands.
+ * - Handles global flags (currently: --no-color, --no-daemon).
+ * - Forwards the command to a running `cheatnote serve`, if any.
+ * - Otherwise initializes DB, registers cleanup, and dispatches commands.
  *
  * Globals defined here (declared extern in include/cheatnote.h):
  *   cn_note_db db;
@@ -25,7 +26,9 @@
 #include "cheatnote.h"
 #include "commands.h"
 #include "db.h"
+#include "lock.h"
 #include "display.h"
+#include "serve.h"
 #include "utils.h"
 
 #include <stdio.h>
@@ -38,6 +41,9 @@ cn_note_db db = {0};
 int use_colors = 1;
 char db_path[PATH_MAX] = "";
 
+/* Forward commands to `cheatnote serve` when it is running */
+static int use_daemon = 1;
+
 /* Remove a single argv entry at index idx, shifting the rest left and
  * decrementing *argc. This preserves argv[0] and the program name.
  */
@@ -54,6 +60,7 @@ static void argv_remove(char **argv, int *argc, int idx)
 /* Process global flags that should not be visible to subcommands.
  * Currently supports:
  *   --no-color    : disable colored output
+ *   --no-daemon   : run the command in this process
  *
  * This intentionally strips recognized global flags from argv so that
  * subcommand parsers see only the subcommand and its args.
@@ -69,6 +76,12 @@ static void process_global_flags(int *argc, char *argv[])
             argv_remove(argv, argc, i);
             i--; /* re-check current index after shift */
         }
+        else if (strcmp(argv[i], "--no-daemon") == 0)
+        {
+            use_daemon = 0;
+            argv_remove(argv, argc, i);
+            i--;
+        }
     }
 
     /* If colors are still enabled, only keep them if stdout is a terminal */
@@ -86,9 +99,24 @@ int main(int argc, char *argv[])
     /* If user asked for help/version without subcommand (e.g., `cheatnote help`),
      * the dispatcher will handle it. Load DB for commands that need it.
      *
-     * We load DB here so commands can assume it's available.
+     * We load DB here so commands can assume it's available. Read-only
+     * commands get a zero-copy mapping; everything else a mutable heap copy.
      */
-    cn_db_load();
+    const char *cmd = argc > 1 ? argv[1] : NULL;
+    int rc;
+    if (use_daemon && cmd && strcmp(cmd, "serve") != 0 && cn_serve_forward(argc, argv, &rc))
+        return rc;
+
+    if (cn_command_is_readonly(cmd))
+    {
+        cn_db_open_readonly();
+    }
+    else
+    {
+        if (cn_command_rewrites_db(cmd))
+            (void)cn_db_lock(CN_LOCK_EXCLUSIVE); /* held until exit */
+        cn_db_load();
+    }
 
     /* Ensure DB memory is freed on normal exit */
     if (atexit(cn_db_cleanup) != 0)
@@ -98,7 +126,7 @@ int main(int argc, char *argv[])
     }
 
     /* Dispatch commands (returns exit code) */
-    int rc = cn_commands_dispatch(argc, argv);
+    rc = cn_commands_dispatch(argc, argv);
 
     /* Return the dispatch result as program exit code */
     return rc;
@@ -7,12 +7,18 @@
 #include <limits.h>
 #include <time.h>
 #include <errno.h>
+#include <ctype.h>
+#include <stdint.h>
 
 #include "cheatnote.h"
 #include "notes_io.h"
 #include "db.h"
 #include "utils.h"
 #include "display.h"
+#include "index.h"
+#include "arena.h"
+#include "idmap.h"
+#include "tags.h"
 
 /* extern globals (defined once in main.c) */
 // db is declared as extern cn_note_db db; in cheatnote.h
@@ -25,7 +31,7 @@ extern char db_path[PATH_MAX];
 static int ensure_capacity_for_one(void)
 {
     /* initialize db if needed */
-    if (!db.notes)
+    if (!db.ids)
     {
         /* cn_db_init will allocate INITIAL_CAPACITY */
         cn_db_init();
@@ -38,7 +44,7 @@ static int ensure_capacity_for_one(void)
     /* Prevent integer overflow when computing new capacity:
      * new_capacity = db.capacity * GROWTH_FACTOR
      */
-    if (db.capacity > SIZE_MAX / GROWTH_FACTOR / sizeof(cn_note))
+    if (db.capacity > SIZE_MAX / GROWTH_FACTOR)
     {
         return 0;
     }
@@ -50,23 +56,110 @@ static int ensure_capacity_for_one(void)
     if (new_capacity <= db.capacity)
         return 0; /* cannot grow further */
 
-    cn_note *new_notes = realloc(db.notes, new_capacity * sizeof(cn_note));
-    if (!new_notes)
+    return cn_db_reserve(new_capacity);
+}
+
+/*
+ * Make room for `extra` more notes in one allocation per column (bulk
+ * import), so the following cn_note_add calls never move the columns.
+ * Requests beyond MAX_NOTES are clamped. Returns 1 on success, 0 on
+ * allocation failure.
+ */
+int cn_note_reserve(size_t extra)
+{
+    if (db.readonly)
         return 0;
+    if (!db.ids)
+        cn_db_init();
+
+    size_t want = extra > MAX_NOTES - db.count ? MAX_NOTES : db.count + extra;
+
+    /* Not zeroed: cn_note_add sets every column, and untouched pages of an
+     * over-estimate then cost no memory */
+    return cn_db_reserve(want);
+}
 
-    /* zero initialize the newly allocated portion */
-    size_t old_bytes = db.capacity * sizeof(cn_note);
-    size_t new_bytes = new_capacity * sizeof(cn_note);
-    if (new_bytes > old_bytes)
+/* The span of s[0..*len) that cn_strip_whitespace would keep */
+static const char *trim_span(const char *s, size_t *len)
+{
+    size_t n = *len;
+    while (n > 0 && isspace((unsigned char)s[n - 1]))
+        --n;
+    while (n > 0 && isspace((unsigned char)*s))
     {
-        memset((char *)new_notes + old_bytes, 0, new_bytes - old_bytes);
+        ++s;
+        --n;
     }
+    *len = n;
+    return s;
+}
 
-    db.notes = new_notes;
-    db.capacity = new_capacity;
+size_t cn_note_preview(const char *content, size_t content_len, char out[MAX_PREVIEW_LEN + 1])
+{
+    const char *nl = memchr(content, '\n', content_len);
+    size_t len = nl ? (size_t)(nl - content) : content_len;
+
+    if (len > MAX_PREVIEW_LEN)
+    {
+        /* Room for "...", backing off UTF-8 continuation bytes */
+        len = MAX_PREVIEW_LEN - 3;
+        while (len > 0 && ((unsigned char)content[len] & 0xC0) == 0x80)
+            --len;
+        memcpy(out, content, len);
+        memcpy(out + len, "...", 4);
+        return len + 3;
+    }
+    memcpy(out, content, len);
+    out[len] = '\0';
+    return len;
+}
+
+/* Replace one text field of a note (stored in `arena`); the old text, if
+ * any, becomes garbage. Returns 1 on success, 0 on allocation failure. */
+static int set_field(cn_arena *arena, cn_text *field, int fresh, const char *str, size_t len)
+{
+    const char *copy = cn_arena_store(arena, str, len);
+    if (!copy)
+        return 0;
+    if (!fresh)
+        cn_arena_release(arena, field->len + 1);
+    field->str = copy;
+    field->len = len;
     return 1;
 }
 
+/* Replace the preview of the note at `slot` with that of `content` */
+static int set_preview(size_t slot, int fresh, const char *content, size_t content_len)
+{
+    char preview[MAX_PREVIEW_LEN + 1];
+    size_t len = cn_note_preview(content, content_len, preview);
+    return set_field(&db.meta_text, &db.previews[slot], fresh, preview, len);
+}
+
+/*
+ * Store new text for the note at `slot`. A NULL field keeps its current
+ * value (fresh slots must pass all three). Strings are copied into the
+ * arenas, titles, tags and the content's preview into the metadata one.
+ * Returns 1 on success, 0 on allocation failure.
+ */
+static int set_text(size_t slot, int fresh, const char *title, size_t title_len,
+                    const char *content, size_t content_len, const char *tags, size_t tags_len)
+{
+    return (!title || set_field(&db.meta_text, &db.titles[slot], fresh, title, title_len)) &&
+           (!content || (set_field(&db.content_text, &db.contents[slot], fresh, content, content_len) &&
+                         set_preview(slot, fresh, content, content_len))) &&
+           (!tags || set_field(&db.meta_text, &db.tags[slot], fresh, tags, tags_len));
+}
+
+/* Release the text of the note at `slot` */
+static void release_text(size_t slot)
+{
+    cn_arena_release(&db.meta_text, db.titles[slot].len + 1);
+    cn_arena_release(&db.content_text, db.contents[slot].len + 1);
+    cn_arena_release(&db.meta_text, db.tags[slot].len + 1);
+    cn_arena_release(&db.meta_text, db.previews[slot].len + 1);
+}
+
 /*
  * Add a new note.
  * Returns new note ID on success, 0 on invalid input or failure.
@@ -74,16 +167,18 @@ static int ensure_capacity_for_one(void)
  */
 unsigned int cn_note_add(const char *title, const char *content, const char *tags)
 {
+    if (db.readonly)
+        return 0;
     if (!title || !content)
         return 0;
 
     if (title[0] == '\0' || content[0] == '\0')
         return 0;
 
-    if (strlen(title) >= MAX_TITLE_LEN || strlen(content) >= MAX_CONTENT_LEN)
-        return 0;
-
-    if (tags && strlen(tags) >= MAX_TAGS_LEN)
+    size_t title_len = strlen(title);
+    size_t content_len = strlen(content);
+    size_t tags_len = tags ? strlen(tags) : 0;
+    if (title_len >= MAX_TITLE_LEN || content_len >= MAX_CONTENT_LEN || tags_len >= MAX_TAGS_LEN)
         return 0;
 
     if (db.count >= MAX_NOTES)
@@ -97,32 +192,30 @@ unsigned int cn_note_add(const char *title, const char *content, const char *tag
         cn_error_exit("Failed to resize database for new note");
     }
 
-    cn_note *note = &db.notes[db.count];
+    size_t slot = db.count;
+
+    /* Trimmed copies into the arenas */
+    title = trim_span(title, &title_len);
+    content = trim_span(content, &content_len);
+    tags = tags ? trim_span(tags, &tags_len) : "";
+    if (!set_text(slot, 1, title, title_len, content, content_len, tags, tags_len))
+        cn_error_exit("Failed to allocate memory for note text");
 
     /* assign ID and protect against wrap to 0 */
-    note->id = db.next_id++;
+    unsigned int id = db.next_id++;
     if (db.next_id == 0) /* wrapped */
         db.next_id = 1;
 
-    /* Safe copies into fixed-size arrays */
-    cn_safe_strncpy(note->title, title, sizeof(note->title));
-    cn_safe_strncpy(note->content, content, sizeof(note->content));
-    if (tags && tags[0] != '\0')
-        cn_safe_strncpy(note->tags, tags, sizeof(note->tags));
-    else
-        note->tags[0] = '\0';
-
-    /* Trim whitespace in-place */
-    cn_strip_whitespace(note->title);
-    cn_strip_whitespace(note->content);
-    cn_strip_whitespace(note->tags);
-
     time_t now = time(NULL);
-    note->created_at = now;
-    note->modified_at = now;
+    db.ids[slot] = id;
+    db.created_at[slot] = now;
+    db.modified_at[slot] = now;
 
+    cn_idmap_set(id, slot);
     db.count++;
-    return note->id;
+    cn_index_touch(id);
+    cn_tags_index(slot);
+    return id;
 }
 
 /*
@@ -134,73 +227,128 @@ unsigned int cn_note_add(const char *title, const char *content, const char *tag
  */
 int cn_note_edit(unsigned int id, const char *title, const char *content, const char *tags)
 {
+    if (db.readonly)
+        return 0;
     if (id == 0)
         return 0;
 
-    for (size_t i = 0; i < db.count; ++i)
+    size_t slot = cn_idmap_find(id);
+    if (slot == SIZE_MAX)
+        return 0; /* not found */
+
+    if (title && title[0] == '\0')
+        title = NULL;
+    if (content && content[0] == '\0')
+        content = NULL;
+
+    size_t title_len = title ? strlen(title) : 0;
+    size_t content_len = content ? strlen(content) : 0;
+    size_t tags_len = tags ? strlen(tags) : 0;
+    if (title_len >= MAX_TITLE_LEN || content_len >= MAX_CONTENT_LEN || tags_len >= MAX_TAGS_LEN)
+        return 0;
+
+    if (title)
+        title = trim_span(title, &title_len);
+    if (content)
+        content = trim_span(content, &content_len);
+    if (tags) /* tags provided; empty string clears tags */
+        tags = trim_span(tags, &tags_len);
+
+    if (!set_text(slot, 0, title, title_len, content, content_len, tags, tags_len))
+        cn_error_exit("Failed to allocate memory for note text");
+    if (tags)
     {
-        if (db.notes[i].id == id)
-        {
-            cn_note *note = &db.notes[i];
-
-            if (title && title[0] != '\0')
-            {
-                if (strlen(title) >= MAX_TITLE_LEN)
-                    return 0;
-                cn_safe_strncpy(note->title, title, sizeof(note->title));
-                cn_strip_whitespace(note->title);
-            }
-
-            if (content && content[0] != '\0')
-            {
-                if (strlen(content) >= MAX_CONTENT_LEN)
-                    return 0;
-                cn_safe_strncpy(note->content, content, sizeof(note->content));
-                cn_strip_whitespace(note->content);
-            }
-
-            if (tags)
-            {
-                /* tags provided; empty string clears tags */
-                if (strlen(tags) >= MAX_TAGS_LEN)
-                    return 0;
-                cn_safe_strncpy(note->tags, tags, sizeof(note->tags));
-                cn_strip_whitespace(note->tags);
-            }
-
-            note->modified_at = time(NULL);
-            return 1;
-        }
+        cn_tags_forget(slot);
+        cn_tags_index(slot);
     }
 
-    return 0; /* not found */
+    db.modified_at[slot] = time(NULL);
+    cn_index_touch(id);
+    cn_db_text_compact();
+    return 1;
 }
 
 /*
  * Delete a note by ID.
- * Uses "move last element into this slot" trick for O(1) deletion order-not-preserving.
+ * Uses "move last element into this slot" trick for O(1) deletion order-not-preserving;
+ * the id map is updated for the moved note.
  * Returns 1 on success, 0 if note not found.
  * Caller should call cn_db_save() after a successful delete.
  */
 int cn_note_delete(unsigned int id)
 {
+    if (db.readonly)
+        return 0;
     if (id == 0)
         return 0;
 
-    for (size_t i = 0; i < db.count; ++i)
+    size_t i = cn_idmap_find(id);
+    if (i == SIZE_MAX)
+        return 0;
+
+    cn_tags_forget(i);
+    release_text(i);
+
+    /* replace this slot with the last note (if not already last) */
+    if (i < db.count - 1)
+    {
+        cn_db_move_note(i, db.count - 1);
+        cn_idmap_set(db.ids[i], i);
+    }
+    db.count--;
+    cn_idmap_remove(id);
+    cn_index_touch(id);
+    cn_db_text_compact();
+    return 1;
+}
+
+/*
+ * Insert or replace a note exactly as given (id, fields and timestamps are
+ * kept; no trimming). Used to replay the journal on load.
+ * Returns 1 on success, 0 on invalid input or allocation failure.
+ */
+int cn_note_put(const cn_note_view *note)
+{
+    if (db.readonly || !note || note->id == 0)
+        return 0;
+
+    if (note->title_len >= MAX_TITLE_LEN || note->content_len >= MAX_CONTENT_LEN ||
+        note->tags_len >= MAX_TAGS_LEN)
+        return 0;
+
+    int fresh = 0;
+    size_t slot = cn_idmap_find(note->id);
+    if (slot == SIZE_MAX)
     {
-        if (db.notes[i].id == id)
-        {
-            /* replace this slot with the last note (if not already last) */
-            if (i < db.count - 1)
-            {
-                db.notes[i] = db.notes[db.count - 1];
-            }
-            /* clear last slot */
-            memset(&db.notes[db.count - 1], 0, sizeof(cn_note));
-            db.count--;
-            return 1;
-        }
+        if (db.count >= MAX_NOTES || !ensure_capacity_for_one())
+            return 0;
+        slot = db.count;
+        fresh = 1;
     }
-    return 0;
+
+    if (!set_text(slot, fresh, note->title, note->title_len, note->content, note->content_len,
+                  note->tags, note->tags_len))
+        return 0;
+    if (fresh)
+        cn_idmap_set(note->id, db.count++);
+    else
+        cn_tags_forget(slot);
+
+    db.ids[slot] = note->id;
+    db.created_at[slot] = note->created_at;
+    db.modified_at[slot] = note->modified_at;
+
+    cn_index_touch(note->id);
+    cn_tags_index(slot);
+    if (!fresh)
+        cn_db_text_compact();
+
+    /* keep next_id ahead of every id in use (protect against wrap to 0) */
+    if (note->id >= db.next_id)
+    {
+        db.next_id = note->id + 1;
+        if (db.next_id == 0)
+            db.next_id = 1;
+    }
+    return 1;
 }
@@ -0,0 +1,1101 @@
+/*
+ * src/re.c
+ *
+ * Regular expressions for `list -r`, without libc regex.
+ *
+ * - cn_re_compile parses a POSIX extended regex into a Thompson NFA: a
+ *   small program of byte-set, split, jump, assertion and match
+ *   instructions.
+ * - cn_re_search runs that program as a DFA built lazily: a DFA state is
+ *   the set of NFA threads alive at a position, and each transition is
+ *   computed the first time some input takes it, then cached. A byte costs
+ *   one table lookup once its transition is known and at most one state
+ *   construction (linear in the program size) otherwise, so a search is
+ *   linear in the text whatever the pattern; nothing ever backtracks.
+ * - Only whether a match exists is computed, which is all search.c asks.
+ *
+ * Supported: literals, `.`, bracket expressions with ranges and [:class:]
+ * names, groups, `|`, `*` `+` `?` `{m}` `{m,}` `{m,n}`, `^` `$`, and the
+ * GNU escapes \b \B \< \> \w \W \s \S \` \'. Back-references cannot be
+ * matched in linear time and are rejected. Matching is bytewise and case
+ * folding ASCII-only, as regcomp behaves in the C locale the CLI runs in.
+ *
+ * Empty-width assertions depend on the bytes around a position, so a DFA
+ * state also records what kind of byte came before it, and assertions are
+ * resolved when the next byte is known. Bytes that no instruction tells
+ * apart share one equivalence class, which keeps transition tables short.
+ *
+ * The compiled program is never modified. DFA caches are pooled on the
+ * cn_re and a search takes one for its duration, so several threads can
+ * search with one cn_re at once, each building states in its own cache.
+ * A cache that outgrows RE_CACHE_BYTES is flushed and refilled.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <pthread.h>
+#define CN_RE_LOCKED 1
+#endif
+
+#include "re.h"
+
+#define RE_MAX_PATTERN 4096     /* bytes of pattern */
+#define RE_MAX_DEPTH 128        /* group nesting */
+#define RE_DUP_MAX 1000         /* largest bound in {m,n} */
+#define RE_MAX_INST 10000       /* program size (counted repeats expand) */
+#define RE_CACHE_BYTES (2u << 20) /* DFA states kept per cache */
+
+/* ------------ Program -------------- */
+
+enum
+{
+    OP_BYTES,  /* consume a byte in sets[x] */
+    OP_SPLIT,  /* continue at x and at y */
+    OP_JMP,    /* continue at x */
+    OP_ASSERT, /* continue if assertion `x` holds here */
+    OP_MATCH
+};
+
+enum
+{
+    AS_BOL,        /* ^ */
+    AS_EOL,        /* $ */
+    AS_WORD,       /* \b */
+    AS_NOT_WORD,   /* \B */
+    AS_WORD_START, /* \< */
+    AS_WORD_END,   /* \> */
+    AS_TEXT_START, /* \` */
+    AS_TEXT_END    /* \' */
+};
+
+/* Kind of the byte before a position */
+enum
+{
+    CTX_BEGIN = 0, /* none: start of text */
+    CTX_NEWLINE,
+    CTX_WORD,
+    CTX_OTHER
+};
+
+typedef struct re_inst
+{
+    uint8_t op;
+    uint32_t x;
+    uint32_t y;
+} re_inst;
+
+typedef struct re_byteset
+{
+    uint64_t bits[4];
+} re_byteset;
+
+struct re_cache;
+
+struct cn_re
+{
+    int flags;
+    re_inst *prog;
+    uint32_t ninst;
+    re_byteset *sets;
+    size_t nsets;
+    int has_asserts;
+
+    /* byte equivalence classes; class `nclasses` stands for end of text */
+    uint8_t byte_class[256];
+    uint8_t class_byte[256]; /* a representative byte per class */
+    unsigned nclasses;
+
+#ifdef CN_RE_LOCKED
+    pthread_mutex_t lock;
+#endif
+    struct re_cache *idle; /* caches not in use by a search */
+};
+
+static int set_has(const re_byteset *s, unsigned c)
+{
+    return (int)((s->bits[c >> 6] >> (c & 63)) & 1u);
+}
+
+static void set_add(re_byteset *s, unsigned c)
+{
+    s->bits[c >> 6] |= (uint64_t)1 << (c & 63);
+}
+
+static void set_add_range(re_byteset *s, unsigned lo, unsigned hi)
+{
+    for (unsigned c = lo; c <= hi; ++c)
+        set_add(s, c);
+}
+
+static void set_invert(re_byteset *s)
+{
+    for (int i = 0; i < 4; ++i)
+        s->bits[i] = ~s->bits[i];
+}
+
+static int is_word_byte(unsigned c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_';
+}
+
+/* Give every letter in s its other case too */
+static void set_fold(re_byteset *s)
+{
+    for (unsigned c = 'a'; c <= 'z'; ++c)
+    {
+        if (set_has(s, c) || set_has(s, c - 32))
+        {
+            set_add(s, c);
+            set_add(s, c - 32);
+        }
+    }
+}
+
+/* ------------ Parser -------------- */
+
+/* Syntax tree, built first so counted repeats can emit their operand
+ * several times */
+enum
+{
+    N_EMPTY,
+    N_SET,    /* a = set index */
+    N_ASSERT, /* a = AS_* */
+    N_CAT,    /* left, right */
+    N_ALT,    /* left, right */
+    N_REPEAT  /* left{a,b}, b < 0 for no upper bound */
+};
+
+typedef struct re_node
+{
+    int type;
+    int a, b;
+    int left, right; /* node indices */
+} re_node;
+
+typedef struct re_parser
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    int flags;
+    int depth;
+    int failed;
+    int bare_anchor; /* the last atom parsed was ^, $ or an \b-style assertion */
+    re_node *nodes;
+    size_t nnodes, nodes_cap;
+    re_byteset *sets;
+    size_t nsets, sets_cap;
+} re_parser;
+
+static int new_node(re_parser *ps, int type, int a, int b, int left, int right)
+{
+    if (ps->failed)
+        return -1;
+    if (ps->nnodes == ps->nodes_cap)
+    {
+        size_t cap = ps->nodes_cap ? ps->nodes_cap * 2 : 64;
+        re_node *grown = realloc(ps->nodes, cap * sizeof(*grown));
+        if (!grown)
+        {
+            ps->failed = 1;
+            return -1;
+        }
+        ps->nodes = grown;
+        ps->nodes_cap = cap;
+    }
+    re_node *n = &ps->nodes[ps->nnodes];
+    n->type = type;
+    n->a = a;
+    n->b = b;
+    n->left = left;
+    n->right = right;
+    return (int)ps->nnodes++;
+}
+
+/* A node matching one byte of `set` (folded under CN_RE_ICASE) */
+static int set_node(re_parser *ps, re_byteset *set)
+{
+    if (ps->failed)
+        return -1;
+    if (ps->flags & CN_RE_ICASE)
+        set_fold(set);
+    if (ps->nsets == ps->sets_cap)
+    {
+        size_t cap = ps->sets_cap ? ps->sets_cap * 2 : 16;
+        re_byteset *grown = realloc(ps->sets, cap * sizeof(*grown));
+        if (!grown)
+        {
+            ps->failed = 1;
+            return -1;
+        }
+        ps->sets = grown;
+        ps->sets_cap = cap;
+    }
+    ps->sets[ps->nsets] = *set;
+    return new_node(ps, N_SET, (int)ps->nsets++, 0, -1, -1);
+}
+
+static int byte_node(re_parser *ps, unsigned c)
+{
+    re_byteset set = {{0}};
+    set_add(&set, c);
+    return set_node(ps, &set);
+}
+
+/* Add the bytes of [:name:] (name[0..len)) to s. Returns 0 if unknown. */
+static int add_named_class(re_byteset *s, const unsigned char *name, size_t len)
+{
+#define IS(lit) (len == sizeof(lit) - 1 && memcmp(name, lit, len) == 0)
+    if (IS("alpha") || IS("alnum") || IS("upper"))
+        set_add_range(s, 'A', 'Z');
+    if (IS("alpha") || IS("alnum") || IS("lower"))
+        set_add_range(s, 'a', 'z');
+    if (IS("digit") || IS("alnum") || IS("xdigit"))
+        set_add_range(s, '0', '9');
+    if (IS("xdigit"))
+    {
+        set_add_range(s, 'a', 'f');
+        set_add_range(s, 'A', 'F');
+    }
+    if (IS("space"))
+        set_add_range(s, '\t', '\r');
+    if (IS("space") || IS("blank"))
+        set_add(s, ' ');
+    if (IS("blank"))
+        set_add(s, '\t');
+    if (IS("punct"))
+    {
+        set_add_range(s, '!', '/');
+        set_add_range(s, ':', '@');
+        set_add_range(s, '[', '`');
+        set_add_range(s, '{', '~');
+    }
+    if (IS("print"))
+        set_add_range(s, ' ', '~');
+    if (IS("graph"))
+        set_add_range(s, '!', '~');
+    if (IS("cntrl"))
+    {
+        set_add_range(s, 0, 31);
+        set_add(s, 127);
+    }
+    return IS("alpha") || IS("alnum") || IS("upper") || IS("lower") || IS("digit") ||
+           IS("xdigit") || IS("space") || IS("blank") || IS("punct") || IS("print") ||
+           IS("graph") || IS("cntrl");
+#undef IS
+}
+
+/* One endpoint of a bracket range: a byte or a [.c.] / [=c=] element.
+ * Returns the byte, or -1 on a syntax error. */
+static int bracket_byte(re_parser *ps)
+{
+    const unsigned char *p = ps->p;
+    if (p[0] == '[' && ps->end - p >= 5 && (p[1] == '.' || p[1] == '=') && p[3] == p[1] &&
+        p[4] == ']')
+    {
+        ps->p += 5;
+        return p[2];
+    }
+    if (p[0] == '[' && ps->end - p >= 2 && (p[1] == '.' || p[1] == '='))
+        return -1; /* multi-character collating elements */
+    ps->p++;
+    return p[0];
+}
+
+/* Bracket expression; ps->p is just past the '[' */
+static int parse_bracket(re_parser *ps)
+{
+    re_byteset set = {{0}};
+    int negate = 0;
+    if (ps->p < ps->end && *ps->p == '^')
+    {
+        negate = 1;
+        ps->p++;
+    }
+
+    for (int first = 1;; first = 0)
+    {
+        if (ps->p >= ps->end)
+            return -1;
+        if (*ps->p == ']' && !first)
+        {
+            ps->p++;
+            break;
+        }
+
+        if (*ps->p == '[' && ps->end - ps->p >= 2 && ps->p[1] == ':')
+        {
+            const unsigned char *name = ps->p + 2;
+            const unsigned char *close = name;
+            while (close + 1 < ps->end && !(close[0] == ':' && close[1] == ']'))
+                ++close;
+            if (close + 1 >= ps->end || !add_named_class(&set, name, (size_t)(close - name)))
+                return -1;
+            ps->p = close + 2;
+            continue;
+        }
+
+        int lo = bracket_byte(ps);
+        if (lo < 0)
+            return -1;
+        int hi = lo;
+        if (ps->end - ps->p >= 2 && ps->p[0] == '-' && ps->p[1] != ']')
+        {
+            ps->p++;
+            hi = bracket_byte(ps);
+            if (hi < lo)
+                return -1;
+        }
+        set_add_range(&set, (unsigned)lo, (unsigned)hi);
+    }
+
+    if (negate)
+    {
+        if (ps->flags & CN_RE_ICASE)
+            set_fold(&set); /* [^a] must not match 'A' either */
+        set_invert(&set);
+        if (ps->flags & CN_RE_NEWLINE)
+            set.bits['\n' >> 6] &= ~((uint64_t)1 << ('\n' & 63));
+    }
+    return set_node(ps, &set);
+}
+
+/* Escape sequence; ps->p is just past the backslash */
+static int parse_escape(re_parser *ps)
+{
+    if (ps->p >= ps->end)
+        return -1;
+    unsigned c = *ps->p++;
+
+    static const char asserts[] = "bB<>`'";
+    const char *kind = c ? strchr(asserts, (int)c) : NULL;
+    if (kind)
+    {
+        ps->bare_anchor = 1;
+        return new_node(ps, N_ASSERT, AS_WORD + (int)(kind - asserts), 0, -1, -1);
+    }
+    if (c >= '1' && c <= '9')
+        return -1; /* back-reference */
+
+    re_byteset set = {{0}};
+    switch (c)
+    {
+    case 'w':
+    case 'W':
+        add_named_class(&set, (const unsigned char *)"alnum", 5);
+        set_add(&set, '_');
+        break;
+    case 's':
+    case 'S':
+        add_named_class(&set, (const unsigned char *)"space", 5);
+        break;
+    default:
+        return byte_node(ps, c);
+    }
+    if (c == 'W' || c == 'S')
+        set_invert(&set);
+    return set_node(ps, &set);
+}
+
+static int parse_alt(re_parser *ps);
+
+static int parse_atom(re_parser *ps)
+{
+    unsigned c = *ps->p++;
+    ps->bare_anchor = 0;
+    switch (c)
+    {
+    case '(':
+    {
+        if (++ps->depth > RE_MAX_DEPTH)
+            return -1;
+        int n = parse_alt(ps);
+        if (n < 0 || ps->p >= ps->end || *ps->p != ')')
+            return -1;
+        ps->p++;
+        ps->depth--;
+        ps->bare_anchor = 0; /* a group of anchors may be repeated */
+        return n;
+    }
+    case '[':
+        return parse_bracket(ps);
+    case '.':
+    {
+        re_byteset set = {{0}};
+        set_invert(&set);
+        if (ps->flags & CN_RE_NEWLINE)
+            set.bits['\n' >> 6] &= ~((uint64_t)1 << ('\n' & 63));
+        return set_node(ps, &set);
+    }
+    case '^':
+        ps->bare_anchor = 1;
+        return new_node(ps, N_ASSERT, AS_BOL, 0, -1, -1);
+    case '$':
+        ps->bare_anchor = 1;
+        return new_node(ps, N_ASSERT, AS_EOL, 0, -1, -1);
+    case '\\':
+        return parse_escape(ps);
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+        return -1; /* nothing to repeat */
+    default:
+        return byte_node(ps, c);
+    }
+}
+
+/* Decimal number of a {m,n} bound, or -1 if absent or too large */
+static int parse_count(re_parser *ps)
+{
+    int n = -1;
+    while (ps->p < ps->end && *ps->p >= '0' && *ps->p <= '9')
+    {
+        n = (n < 0 ? 0 : n * 10) + (*ps->p++ - '0');
+        if (n > RE_DUP_MAX)
+            return -1;
+    }
+    return n;
+}
+
+/* Atom followed by any quantifiers */
+static int parse_repeat(re_parser *ps)
+{
+    int n = parse_atom(ps);
+    int bare_anchor = ps->bare_anchor;
+    while (n >= 0 && ps->p < ps->end)
+    {
+        int min, max;
+        unsigned c = *ps->p;
+        if (c == '*')
+            min = 0, max = -1;
+        else if (c == '+')
+            min = 1, max = -1;
+        else if (c == '?')
+            min = 0, max = 1;
+        else if (c == '{')
+        {
+            ps->p++;
+            min = parse_count(ps);
+            max = min;
+            if (ps->p < ps->end && *ps->p == ',')
+            {
+                ps->p++;
+                max = ps->p < ps->end && *ps->p == '}' ? -1 : parse_count(ps);
+                if (max < 0 && (ps->p >= ps->end || *ps->p != '}'))
+                    return -1;
+            }
+            if (min < 0 || ps->p >= ps->end || *ps->p != '}' || (max >= 0 && max < min))
+                return -1;
+        }
+        else
+            break;
+        ps->p++;
+
+        if (bare_anchor)
+            return -1; /* as regcomp: an anchor cannot be repeated, a group can */
+        n = new_node(ps, N_REPEAT, min, max, n, -1);
+    }
+    return n;
+}
+
+static int parse_concat(re_parser *ps)
+{
+    int n = new_node(ps, N_EMPTY, 0, 0, -1, -1);
+    while (n >= 0 && ps->p < ps->end && *ps->p != '|' && !(*ps->p == ')' && ps->depth > 0))
+    {
+        int item = parse_repeat(ps);
+        if (item < 0)
+            return -1;
+        n = ps->nodes[n].type == N_EMPTY ? item : new_node(ps, N_CAT, 0, 0, n, item);
+    }
+    return n;
+}
+
+static int parse_alt(re_parser *ps)
+{
+    int n = parse_concat(ps);
+    while (n >= 0 && ps->p < ps->end && *ps->p == '|')
+    {
+        ps->p++;
+        int right = parse_concat(ps);
+        if (right < 0)
+            return -1;
+        n = new_node(ps, N_ALT, 0, 0, n, right);
+    }
+    return n;
+}
+
+/* ------------ Code generation -------------- */
+
+/* Append an instruction; returns its index, or -1 past RE_MAX_INST */
+static int emit(cn_re *re, uint8_t op, uint32_t x, uint32_t y)
+{
+    if (re->ninst >= RE_MAX_INST)
+        return -1;
+    re->prog[re->ninst].op = op;
+    re->prog[re->ninst].x = x;
+    re->prog[re->ninst].y = y;
+    return (int)re->ninst++;
+}
+
+/* Emit the code of node n. Returns 1 on success, 0 if the program got too
+ * large. */
+static int gen(cn_re *re, const re_node *nodes, int n)
+{
+    const re_node *node = &nodes[n];
+    switch (node->type)
+    {
+    case N_EMPTY:
+        return 1;
+    case N_SET:
+        return emit(re, OP_BYTES, (uint32_t)node->a, 0) >= 0;
+    case N_ASSERT:
+        re->has_asserts = 1;
+        return emit(re, OP_ASSERT, (uint32_t)node->a, 0) >= 0;
+    case N_CAT:
+        return gen(re, nodes, node->left) && gen(re, nodes, node->right);
+    case N_ALT:
+    {
+        int split = emit(re, OP_SPLIT, 0, 0);
+        if (split < 0 || !gen(re, nodes, node->left))
+            return 0;
+        int jmp = emit(re, OP_JMP, 0, 0);
+        if (jmp < 0)
+            return 0;
+        re->prog[split].x = (uint32_t)split + 1;
+        re->prog[split].y = re->ninst;
+        if (!gen(re, nodes, node->right))
+            return 0;
+        re->prog[jmp].x = re->ninst;
+        return 1;
+    }
+    case N_REPEAT:
+    {
+        for (int i = 0; i < node->a; ++i)
+        {
+            if (!gen(re, nodes, node->left))
+                return 0;
+        }
+        if (node->b < 0)
+        {
+            /* loop: split(body, out); body; jmp loop */
+            int split = emit(re, OP_SPLIT, 0, 0);
+            if (split < 0 || !gen(re, nodes, node->left) || emit(re, OP_JMP, (uint32_t)split, 0) < 0)
+                return 0;
+            re->prog[split].x = (uint32_t)split + 1;
+            re->prog[split].y = re->ninst;
+            return 1;
+        }
+
+        /* optional copies, each of which may skip to the end */
+        uint32_t first = re->ninst;
+        for (int i = node->a; i < node->b; ++i)
+        {
+            if (emit(re, OP_SPLIT, 0, 0) < 0 || !gen(re, nodes, node->left))
+                return 0;
+        }
+        for (uint32_t pc = first; pc < re->ninst; ++pc)
+        {
+            /* only the splits emitted above point at 0: patch them */
+            if (re->prog[pc].op == OP_SPLIT && re->prog[pc].y == 0 && re->prog[pc].x == 0)
+            {
+                re->prog[pc].x = pc + 1;
+                re->prog[pc].y = re->ninst;
+            }
+        }
+        return 1;
+    }
+    }
+    return 0;
+}
+
+/* Split bytes into classes no instruction tells apart */
+static void build_classes(cn_re *re)
+{
+    unsigned char cut[256] = {0};
+    for (size_t s = 0; s < re->nsets; ++s)
+    {
+        for (unsigned c = 1; c < 256; ++c)
+        {
+            if (set_has(&re->sets[s], c) != set_has(&re->sets[s], c - 1))
+                cut[c] = 1;
+        }
+    }
+    /* assertions look at word bytes and line breaks */
+    for (unsigned c = 1; c < 256; ++c)
+    {
+        if (is_word_byte(c) != is_word_byte(c - 1))
+            cut[c] = 1;
+    }
+    cut['\n'] = cut['\n' + 1] = 1;
+
+    unsigned cls = 0;
+    re->class_byte[0] = 0;
+    for (unsigned c = 0; c < 256; ++c)
+    {
+        if (c > 0 && cut[c])
+            re->class_byte[++cls] = (uint8_t)c;
+        re->byte_class[c] = (uint8_t)cls;
+    }
+    re->nclasses = cls + 1;
+}
+
+cn_re *cn_re_compile(const char *pattern, int flags)
+{
+    if (!pattern)
+        return NULL;
+    size_t len = strlen(pattern);
+    if (len > RE_MAX_PATTERN)
+        return NULL;
+
+    re_parser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.p = (const unsigned char *)pattern;
+    ps.end = ps.p + len;
+    ps.flags = flags;
+
+    /* Outside any group a ')' is a literal, as in regcomp, so the whole
+     * pattern is consumed */
+    int root = parse_alt(&ps);
+
+    cn_re *re = NULL;
+    if (root >= 0 && !ps.failed)
+        re = calloc(1, sizeof(*re));
+    if (re)
+    {
+        re->flags = flags;
+        re->sets = ps.sets;
+        re->nsets = ps.nsets;
+        ps.sets = NULL;
+        re->prog = malloc(RE_MAX_INST * sizeof(*re->prog));
+        if (!re->prog || !gen(re, ps.nodes, root) || emit(re, OP_MATCH, 0, 0) < 0)
+        {
+            cn_re_free(re);
+            re = NULL;
+        }
+    }
+    free(ps.nodes);
+    free(ps.sets);
+    if (!re)
+        return NULL;
+
+    re_inst *fitted = realloc(re->prog, re->ninst * sizeof(*fitted));
+    if (fitted)
+        re->prog = fitted;
+    build_classes(re);
+#ifdef CN_RE_LOCKED
+    if (pthread_mutex_init(&re->lock, NULL) != 0)
+    {
+        free(re->prog);
+        free(re->sets);
+        free(re);
+        return NULL;
+    }
+#endif
+    return re;
+}
+
+/* ------------ Lazy DFA -------------- */
+
+/* A DFA state: the sorted NFA threads at a position (byte-set, pending
+ * assertion and match instructions) and the kind of byte before it. */
+typedef struct re_state
+{
+    uint32_t hash;
+    uint32_t n;
+    int ctx;
+    const uint32_t *pcs;
+    struct re_state *next[]; /* per byte class, then end of text; NULL = not built */
+} re_state;
+
+/* Transition targets that are not states */
+static void *match_marker;
+static void *no_match_marker;
+#define STATE_MATCH ((re_state *)(void *)&match_marker)
+#define STATE_NO_MATCH ((re_state *)(void *)&no_match_marker)
+
+typedef struct re_cache
+{
+    struct re_cache *next_idle;
+    re_state **table; /* open addressing, power of two */
+    size_t table_cap;
+    size_t nstates;
+    size_t bytes;
+    re_state *start; /* at the start of text, NULL until built */
+    int flushed;     /* set when a flush freed the states */
+
+    /* scratch sized for the program */
+    uint32_t *stack;
+    uint32_t *mark; /* generation a pc was last added in */
+    uint32_t gen;
+    uint32_t *cur;
+    uint32_t *nxt;
+} re_cache;
+
+static void cache_flush(re_cache *c)
+{
+    for (size_t i = 0; i < c->table_cap; ++i)
+    {
+        free(c->table[i]);
+        c->table[i] = NULL;
+    }
+    c->nstates = 0;
+    c->bytes = 0;
+    c->start = NULL;
+    c->flushed = 1;
+}
+
+static void cache_free(re_cache *c)
+{
+    if (!c)
+        return;
+    if (c->table)
+        cache_flush(c);
+    free(c->table);
+    free(c->stack);
+    free(c->mark);
+    free(c->cur);
+    free(c->nxt);
+    free(c);
+}
+
+static re_cache *cache_new(const cn_re *re)
+{
+    re_cache *c = calloc(1, sizeof(*c));
+    if (!c)
+        return NULL;
+    c->table_cap = 64;
+    c->table = calloc(c->table_cap, sizeof(*c->table));
+    c->stack = malloc((2 * (size_t)re->ninst + 1) * sizeof(*c->stack)); /* <= 2 pushes per pc */
+    c->mark = calloc(re->ninst, sizeof(*c->mark));
+    c->cur = malloc(re->ninst * sizeof(*c->cur));
+    c->nxt = malloc(re->ninst * sizeof(*c->nxt));
+    if (!c->table || !c->stack || !c->mark || !c->cur || !c->nxt)
+    {
+        cache_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+/* Start a new set of instructions (clears the marks) */
+static void next_gen(re_cache *c, const cn_re *re)
+{
+    if (++c->gen == 0)
+    {
+        memset(c->mark, 0, re->ninst * sizeof(*c->mark));
+        c->gen = 1;
+    }
+}
+
+static int assertion_holds(const cn_re *re, uint32_t kind, int ctx, int next)
+{
+    int before = ctx == CTX_WORD;
+    int after = next >= 0 && is_word_byte((unsigned)next);
+    switch (kind)
+    {
+    case AS_BOL:
+        return ctx == CTX_BEGIN || (ctx == CTX_NEWLINE && (re->flags & CN_RE_NEWLINE));
+    case AS_EOL:
+        return next < 0 || (next == '\n' && (re->flags & CN_RE_NEWLINE));
+    case AS_WORD:
+        return before != after;
+    case AS_NOT_WORD:
+        return before == after;
+    case AS_WORD_START:
+        return !before && after;
+    case AS_WORD_END:
+        return before && !after;
+    case AS_TEXT_START:
+        return ctx == CTX_BEGIN;
+    case AS_TEXT_END:
+        return next < 0;
+    }
+    return 0;
+}
+
+/*
+ * Add pc and every instruction reachable from it without consuming a byte
+ * to out[*n] (byte-set, match and, unless `resolve`, assertion
+ * instructions). With `resolve`, assertions are evaluated for a position
+ * after a `ctx` byte and before `next` (-1 at end of text) and followed
+ * when they hold. Instructions already marked in this generation are
+ * skipped.
+ */
+static void add_thread(const cn_re *re, re_cache *c, uint32_t pc, int resolve, int ctx, int next,
+                       uint32_t *out, uint32_t *n)
+{
+    size_t top = 0;
+    c->stack[top++] = pc;
+    while (top > 0)
+    {
+        pc = c->stack[--top];
+        if (c->mark[pc] == c->gen)
+            continue;
+        c->mark[pc] = c->gen;
+
+        const re_inst *in = &re->prog[pc];
+        switch (in->op)
+        {
+        case OP_SPLIT:
+            c->stack[top++] = in->y;
+            c->stack[top++] = in->x;
+            break;
+        case OP_JMP:
+            c->stack[top++] = in->x;
+            break;
+        case OP_ASSERT:
+            if (!resolve)
+                out[(*n)++] = pc;
+            else if (assertion_holds(re, in->x, ctx, next))
+                c->stack[top++] = pc + 1;
+            break;
+        default:
+            out[(*n)++] = pc;
+            break;
+        }
+    }
+}
+
+static int cmp_pc(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t hash_state(const uint32_t *pcs, uint32_t n, int ctx)
+{
+    uint32_t h = 2166136261u ^ (uint32_t)ctx;
+    for (uint32_t i = 0; i < n; ++i)
+        h = (h ^ pcs[i]) * 16777619u;
+    return h;
+}
+
+/* Insert s into the table (which has room) */
+static void table_put(re_cache *c, re_state *s)
+{
+    size_t i = s->hash & (c->table_cap - 1);
+    while (c->table[i])
+        i = (i + 1) & (c->table_cap - 1);
+    c->table[i] = s;
+}
+
+/* The state for the sorted threads pcs[0..n) after a `ctx` byte, found or
+ * added. Returns NULL on allocation failure. May flush the cache. */
+static re_state *intern(const cn_re *re, re_cache *c, const uint32_t *pcs, uint32_t n, int ctx)
+{
+    uint32_t h = hash_state(pcs, n, ctx);
+    for (size_t i = h & (c->table_cap - 1); c->table[i]; i = (i + 1) & (c->table_cap - 1))
+    {
+        re_state *s = c->table[i];
+        if (s->hash == h && s->n == n && s->ctx == ctx &&
+            memcmp(s->pcs, pcs, n * sizeof(*pcs)) == 0)
+            return s;
+    }
+
+    size_t size = sizeof(re_state) + (re->nclasses + 1) * sizeof(re_state *) + n * sizeof(*pcs);
+    if (c->bytes + size > RE_CACHE_BYTES && c->nstates > 0)
+        cache_flush(c);
+
+    if ((c->nstates + 1) * 2 > c->table_cap)
+    {
+        size_t cap = c->table_cap * 2;
+        re_state **table = calloc(cap, sizeof(*table));
+        if (!table)
+            return NULL;
+        re_state **old = c->table;
+        size_t old_cap = c->table_cap;
+        c->table = table;
+        c->table_cap = cap;
+        for (size_t i = 0; i < old_cap; ++i)
+        {
+            if (old[i])
+                table_put(c, old[i]);
+        }
+        free(old);
+    }
+
+    re_state *s = calloc(1, size);
+    if (!s)
+        return NULL;
+    uint32_t *stored = (uint32_t *)(void *)(s->next + re->nclasses + 1);
+    memcpy(stored, pcs, n * sizeof(*pcs));
+    s->pcs = stored;
+    s->n = n;
+    s->ctx = ctx;
+    s->hash = h;
+    table_put(c, s);
+    c->nstates++;
+    c->bytes += size;
+    return s;
+}
+
+static int has_match(const cn_re *re, const uint32_t *pcs, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        if (re->prog[pcs[i]].op == OP_MATCH)
+            return 1;
+    }
+    return 0;
+}
+
+static int ctx_of(const cn_re *re, unsigned c)
+{
+    if (!re->has_asserts)
+        return CTX_BEGIN; /* nothing looks at it: fewer distinct states */
+    if (c == '\n')
+        return CTX_NEWLINE;
+    return is_word_byte(c) ? CTX_WORD : CTX_OTHER;
+}
+
+/* Threads of the search starting at pc 0 (unanchored: added at every
+ * position), as a state after a `ctx` byte */
+static re_state *start_state(const cn_re *re, re_cache *c)
+{
+    uint32_t n = 0;
+    next_gen(c, re);
+    add_thread(re, c, 0, 0, CTX_BEGIN, 0, c->nxt, &n);
+    if (has_match(re, c->nxt, n))
+        return STATE_MATCH;
+    qsort(c->nxt, n, sizeof(*c->nxt), cmp_pc);
+    return intern(re, c, c->nxt, n, CTX_BEGIN);
+}
+
+/* The state after s on byte class `cls` (nclasses: end of text), built and
+ * recorded in s->next. Returns STATE_MATCH as soon as a match ends here,
+ * STATE_NO_MATCH at the end of text without one, NULL on allocation
+ * failure. */
+static re_state *step(const cn_re *re, re_cache *c, re_state *s, unsigned cls)
+{
+    int next = cls < re->nclasses ? re->class_byte[cls] : -1;
+
+    /* resolve the assertions pending at this position */
+    uint32_t ncur = 0;
+    next_gen(c, re);
+    for (uint32_t i = 0; i < s->n; ++i)
+        add_thread(re, c, s->pcs[i], 1, s->ctx, next, c->cur, &ncur);
+
+    re_state *to;
+    if (has_match(re, c->cur, ncur))
+        to = STATE_MATCH;
+    else if (next < 0)
+        to = STATE_NO_MATCH;
+    else
+    {
+        uint32_t nnxt = 0;
+        next_gen(c, re);
+        for (uint32_t i = 0; i < ncur; ++i)
+        {
+            const re_inst *in = &re->prog[c->cur[i]];
+            if (in->op == OP_BYTES && set_has(&re->sets[in->x], (unsigned)next))
+                add_thread(re, c, c->cur[i] + 1, 0, 0, 0, c->nxt, &nnxt);
+        }
+        add_thread(re, c, 0, 0, 0, 0, c->nxt, &nnxt);
+
+        if (has_match(re, c->nxt, nnxt))
+            to = STATE_MATCH;
+        else
+        {
+            qsort(c->nxt, nnxt, sizeof(*c->nxt), cmp_pc);
+            c->flushed = 0;
+            to = intern(re, c, c->nxt, nnxt, ctx_of(re, (unsigned)next));
+            if (!to)
+                return NULL;
+            if (c->flushed)
+                return to; /* s is gone */
+        }
+    }
+    s->next[cls] = to;
+    return to;
+}
+
+static int run(const cn_re *re, re_cache *c, const unsigned char *text, size_t len)
+{
+    re_state *s = c->start;
+    if (!s)
+    {
+        s = start_state(re, c);
+        if (!s)
+            return -1;
+        if (s == STATE_MATCH)
+            return 1;
+        c->start = s;
+    }
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned cls = re->byte_class[text[i]];
+        re_state *to = s->next[cls];
+        if (!to)
+        {
+            to = step(re, c, s, cls);
+            if (!to)
+                return -1;
+        }
+        if (to == STATE_MATCH)
+            return 1;
+        s = to;
+    }
+
+    re_state *end = s->next[re->nclasses];
+    if (!end)
+        end = step(re, c, s, re->nclasses);
+    if (!end)
+        return -1;
+    return end == STATE_MATCH;
+}
+
+int cn_re_search(const cn_re *re, const char *text, size_t len)
+{
+    /* The compiled program is read-only; only the idle list changes */
+    cn_re *pool = (cn_re *)re;
+
+#ifdef CN_RE_LOCKED
+    pthread_mutex_lock(&pool->lock);
+#endif
+    re_cache *c = pool->idle;
+    if (c)
+        pool->idle = c->next_idle;
+#ifdef CN_RE_LOCKED
+    pthread_mutex_unlock(&pool->lock);
+#endif
+
+    if (!c && !(c = cache_new(re)))
+        return -1;
+
+    int rc = run(re, c, (const unsigned char *)text, len);
+
+#ifdef CN_RE_LOCKED
+    pthread_mutex_lock(&pool->lock);
+#endif
+    c->next_idle = pool->idle;
+    pool->idle = c;
+#ifdef CN_RE_LOCKED
+    pthread_mutex_unlock(&pool->lock);
+#endif
+    return rc;
+}
+
+void cn_re_free(cn_re *re)
+{
+    if (!re)
+        return;
+    while (re->idle)
+    {
+        re_cache *c = re->idle;
+        re->idle = c->next_idle;
+        cache_free(c);
+    }
+#ifdef CN_RE_LOCKED
+    if (re->nclasses)
+        pthread_mutex_destroy(&re->lock);
+#endif
+    free(re->prog);
+    free(re->sets);
+    free(re);
+}
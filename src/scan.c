@@ -0,0 +1,228 @@
+/*
+ * src/scan.c
+ *
+ * Whole-database search for `list`.
+ *
+ * The notes array is cut into fixed-size chunks that worker threads claim
+ * from a shared atomic counter, so a few expensive notes (long content,
+ * slow regexes) do not leave other cores idle. The query is compiled once
+ * and shared: matchers are read-only while matching, and the regex engine
+ * (re.c) gives each concurrent search its own DFA cache.
+ *
+ * Results are written to a per-note hit array rather than per-thread lists,
+ * so the caller prints them in database order without any merge step and
+ * output is identical to a sequential scan.
+ *
+ * On a loaded (heap) database, which the `serve` daemon and `batch` keep
+ * across queries, a tag filter (`-g`) is resolved first through the tag
+ * dictionary (tags.c); the scan then only evaluates the content query on
+ * the notes it selected.
+ *
+ * Small databases and Windows builds scan on the calling thread.
+ *
+ * Workers never call cn_error_exit: serve and batch turn it into a longjmp
+ * that must not leave another thread. A failed match is flagged instead,
+ * stops the workers, and is reported once they have been joined.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#define CN_HAVE_THREADS 1
+#endif
+
+#include "cheatnote.h"
+#include "scan.h"
+#include "search.h"
+#include "db.h"
+#include "index.h"
+#include "tags.h"
+
+#define SCAN_CHUNK 1024      /* notes claimed per step */
+#define SCAN_MIN_PER_JOB 4096 /* below this a thread costs more than it saves */
+#define SCAN_MAX_JOBS 64
+
+/* Evaluate slots [begin, end) with matcher m; returns the number of hits,
+ * or -1 if matching failed. With `prefiltered`, only slots already set in
+ * hits are candidates. */
+static long scan_range(const cn_matcher *m, int indexed, int prefiltered, size_t begin,
+                       size_t end, unsigned char *hits)
+{
+    long found = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (prefiltered && !hits[i])
+            continue;
+        hits[i] = 0;
+        if (indexed && !cn_index_is_candidate(cn_db_note_id(i)))
+            continue;
+
+        cn_note_view note;
+        cn_db_note_view(i, &note);
+        int rc = cn_matcher_match(m, &note);
+        if (rc < 0)
+            return -1;
+        if (rc)
+        {
+            hits[i] = 1;
+            ++found;
+        }
+    }
+    return found;
+}
+
+int cn_scan_jobs(int jobs, size_t count)
+{
+#ifdef CN_HAVE_THREADS
+    if (jobs <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cores > 0 ? (int)cores : 1;
+
+        /* Auto mode only: keep enough work per thread to pay for it */
+        size_t useful = count / SCAN_MIN_PER_JOB;
+        if ((size_t)jobs > useful)
+            jobs = useful > 0 ? (int)useful : 1;
+    }
+    if (jobs > SCAN_MAX_JOBS)
+        jobs = SCAN_MAX_JOBS;
+    size_t chunks = (count + SCAN_CHUNK - 1) / SCAN_CHUNK;
+    if ((size_t)jobs > chunks)
+        jobs = chunks > 0 ? (int)chunks : 1;
+    return jobs;
+#else
+    (void)jobs;
+    (void)count;
+    return 1;
+#endif
+}
+
+#ifdef CN_HAVE_THREADS
+
+typedef struct
+{
+    const cn_matcher *matcher;
+    int indexed;
+    int prefiltered;
+    unsigned char *hits;
+    size_t count;
+    atomic_size_t next_chunk;
+    atomic_int failed; /* a match failed: stop claiming chunks */
+} scan_shared;
+
+typedef struct
+{
+    scan_shared *shared;
+    long found;
+} scan_worker;
+
+static void *scan_thread(void *arg)
+{
+    scan_worker *w = arg;
+    scan_shared *s = w->shared;
+    size_t chunks = (s->count + SCAN_CHUNK - 1) / SCAN_CHUNK;
+
+    while (!atomic_load(&s->failed))
+    {
+        size_t c = atomic_fetch_add(&s->next_chunk, 1);
+        if (c >= chunks)
+            break;
+        size_t begin = c * SCAN_CHUNK;
+        size_t end = begin + SCAN_CHUNK < s->count ? begin + SCAN_CHUNK : s->count;
+        long found = scan_range(s->matcher, s->indexed, s->prefiltered, begin, end, s->hits);
+        if (found < 0)
+            atomic_store(&s->failed, 1);
+        else
+            w->found += found;
+    }
+    return NULL;
+}
+
+#endif /* CN_HAVE_THREADS */
+
+/* Evaluate matcher m on every (candidate) slot with `jobs` threads */
+static long scan_notes(const cn_matcher *m, int indexed, int prefiltered, int jobs,
+                       unsigned char *hits)
+{
+    jobs = cn_scan_jobs(jobs, db.count);
+
+    if (jobs <= 1)
+        return scan_range(m, indexed, prefiltered, 0, db.count, hits);
+
+#ifdef CN_HAVE_THREADS
+    scan_shared shared;
+    shared.matcher = m;
+    shared.indexed = indexed;
+    shared.prefiltered = prefiltered;
+    shared.hits = hits;
+    shared.count = db.count;
+    atomic_init(&shared.next_chunk, 0);
+    atomic_init(&shared.failed, 0);
+
+    scan_worker *workers = calloc((size_t)jobs, sizeof(*workers));
+    pthread_t *threads = calloc((size_t)jobs, sizeof(*threads));
+    if (!workers || !threads)
+    {
+        free(workers);
+        free(threads);
+        return scan_notes(m, indexed, prefiltered, 1, hits);
+    }
+
+    /* Worker 0 runs on the calling thread; a failed spawn just leaves
+     * its chunks to the others. */
+    int started = 0;
+    for (int t = 0; t < jobs; ++t)
+        workers[t].shared = &shared;
+    for (int t = 1; t < jobs; ++t)
+    {
+        if (pthread_create(&threads[started], NULL, scan_thread, &workers[t]) == 0)
+            ++started;
+    }
+    scan_thread(&workers[0]);
+    for (int t = 0; t < started; ++t)
+        pthread_join(threads[t], NULL);
+
+    long found = 0;
+    for (int t = 0; t < jobs; ++t)
+        found += workers[t].found;
+    free(workers);
+    free(threads);
+    return atomic_load(&shared.failed) ? -1 : found;
+#else
+    return -1;
+#endif
+}
+
+/* Compile opts once and scan with it; -1 on allocation failure while
+ * compiling or matching */
+static long scan_query(const cn_search_opts *opts, int indexed, int prefiltered, int jobs,
+                       unsigned char *hits)
+{
+    cn_matcher *m = cn_matcher_compile(opts);
+    if (!m)
+        return -1;
+    long found = scan_notes(m, indexed, prefiltered, jobs, hits);
+    cn_matcher_free(m);
+    return found;
+}
+
+long cn_scan_notes(const cn_search_opts *opts, int indexed, int jobs, unsigned char *hits)
+{
+    /* A one-shot read-only open would spend longer building the
+     * dictionary than the parallel scan takes to check the tags */
+    if (!opts->tags || !*opts->tags || db.readonly)
+        return scan_query(opts, indexed, 0, jobs, hits);
+
+    /* Tag filters are answered by the tag dictionary; only a content query
+     * is left to evaluate, on the notes it selected */
+    long tagged = cn_tags_select(opts->tags, hits);
+    if (tagged <= 0 || !opts->pattern || !*opts->pattern)
+        return tagged;
+    cn_search_opts content_only = *opts;
+    content_only.tags = NULL;
+    return scan_query(&content_only, indexed, 1, jobs, hits);
+}
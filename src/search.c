@@ -4,14 +4,24 @@
  * Search & matching utilities for CheatNote.
  *
  * Provides:
+ *   - cn_matcher_compile / cn_matcher_match / cn_matcher_free
+ *       prepared queries: cn_search_opts are compiled once (regex, folded
+ *       pattern, split tag filter) and then evaluated against many notes,
+ *       from any number of threads at once
  *   - cn_note_match_tags(const char *note_tags, const char *search_tags)
- *   - cn_note_match_content(const cn_note *note, const cn_search_opts *opts)
+ *   - cn_note_match_content(const cn_note_view *note, const cn_search_opts *opts)
+ *       one-shot convenience wrappers around a temporary matcher
  *
  * Behavior:
- *   - Tag match: case-insensitive, comma-separated; empty search_tags => match all.
- *   - Content match: supports regex mode (POSIX regex) and substring mode.
+ *   - Tag match: exact on normalized tags (cn_tag_next: comma-separated,
+ *     trimmed, case-insensitive), every filter tag required; empty
+ *     search_tags => match all. `list` resolves tag filters through the
+ *     tag dictionary (tags.c) instead; both give the same answer.
+ *   - Content match: supports regex mode (POSIX ERE through the built-in,
+ *     linear-time engine in re.c) and substring mode.
  *     - In regex mode, supports case-insensitive and multiline flags.
- *     - In substring mode, supports case-insensitive and exact-match options.
+ *     - In substring mode, supports case-insensitive and exact-match options;
+ *       case-insensitive matching folds in place (strsearch.c), no copies.
  *
  * Safety:
  *   - All allocations are checked and freed.
@@ -26,230 +36,267 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <regex.h>
 #include <limits.h>
 
 #include "cheatnote.h"
 #include "search.h"
 #include "utils.h" /* for cn_safe_strncpy, cn_strip_whitespace if needed */
+#include "strsearch.h"
+#include "tags.h"
+#include "re.h"
+#include "display.h"
 
-/* ------------ Tag matching -------------- */
-/* Case-insensitive comma-separated match.
- * Returns 1 if search_tags is NULL/empty (match-all), 0 otherwise.
- */
-int cn_note_match_tags(const char *note_tags, const char *search_tags)
+struct cn_matcher
 {
-    if (!search_tags || !*search_tags)
-        return 1; /* no tag filter => match */
-
-    if (!note_tags || !*note_tags)
-        return 0; /* note has no tags but search requires some */
+    /* content query */
+    int has_pattern;
+    int regex_mode;
+    cn_re *regex; /* NULL if the regex failed to compile: nothing matches */
+    int exact_match;
+    cn_finder pattern; /* substring/exact modes */
 
-    size_t note_len = strlen(note_tags);
-    size_t search_len = strlen(search_tags);
+    /* tag filter: normalized tags, each NUL-terminated, back to back */
+    char *tags;
+    size_t tag_count;
+};
 
-    /* Basic sanity checks */
-    if (note_len >= MAX_TAGS_LEN || search_len >= MAX_TAGS_LEN)
-        return 0;
-
-    char *note_copy = malloc(note_len + 1);
-    char *search_copy = malloc(search_len + 1);
-    if (!note_copy || !search_copy)
-    {
-        free(note_copy);
-        free(search_copy);
-        return 0;
-    }
+/* Compile the regex for opts (with optional \b wrapping).
+ * Returns it, or NULL on invalid or oversized pattern. */
+static cn_re *compile_regex(const cn_search_opts *opts)
+{
+    int flags = 0;
+    if (opts->multiline_mode)
+        flags |= CN_RE_NEWLINE;
+    if (opts->case_insensitive)
+        flags |= CN_RE_ICASE;
 
-    strcpy(note_copy, note_tags);
-    strcpy(search_copy, search_tags);
+    /* Build pattern with optional word boundary wrapping */
+    size_t patlen = strlen(opts->pattern);
+    size_t need = patlen + 16; /* room for \b .. \b and NUL */
+    if (need > MAX_SEARCH_LEN * 4)
+        return NULL; /* pattern too large */
 
-    /* Lowercase both for case-insensitive match */
-    for (char *p = note_copy; *p; ++p)
-        *p = (char)tolower((unsigned char)*p);
-    for (char *p = search_copy; *p; ++p)
-        *p = (char)tolower((unsigned char)*p);
+    char *pattern_buf = malloc(need);
+    if (!pattern_buf)
+        return NULL;
 
-    /* Tokenize search_copy by commas and check each token is a substring of note_copy */
-    int match = 1;
-    char *saveptr = NULL;
-    char *token = strtok_r(search_copy, ",", &saveptr);
-    while (token)
+    if (opts->word_boundary)
     {
-        /* Trim whitespace around token */
-        cn_strip_whitespace(token);
-        if (*token != '\0')
+        /* wrap with word boundary tokens (\b), which need escaping in C string */
+        int rc = snprintf(pattern_buf, need, "\\b%s\\b", opts->pattern);
+        if (rc < 0 || (size_t)rc >= need)
         {
-            if (!strstr(note_copy, token))
-            {
-                match = 0;
-                break;
-            }
+            free(pattern_buf);
+            return NULL;
         }
-        token = strtok_r(NULL, ",", &saveptr);
+    }
+    else
+    {
+        memcpy(pattern_buf, opts->pattern, patlen + 1);
     }
 
-    free(note_copy);
-    free(search_copy);
-    return match;
+    cn_re *re = cn_re_compile(pattern_buf, flags);
+    free(pattern_buf);
+    return re;
 }
 
-/* ------------ Content/title/tags matching -------------- */
-/* Returns 1 if note matches the search options, 0 otherwise.
- * opts->pattern may be NULL or empty => match-all.
- */
-int cn_note_match_content(const cn_note *note, const cn_search_opts *opts)
+/* Split the tag filter into normalized tags. Returns 1 on success, 0 on
+ * allocation failure. */
+static int compile_tags(cn_matcher *m, const char *search_tags)
 {
-    if (!note || !opts)
+    size_t len = strlen(search_tags);
+    m->tags = malloc(len + 1);
+    char *name = malloc(MAX_TAGS_LEN);
+    if (!m->tags || !name)
+    {
+        free(name);
         return 0;
+    }
 
-    if (!opts->pattern || !*opts->pattern)
-        return 1; /* nothing to search => matches */
-
-    /* REGEX MODE */
-    if (opts->regex_mode)
+    size_t pos = 0, used = 0, n;
+    while ((n = cn_tag_next(search_tags, len, &pos, name)) > 0)
     {
-        regex_t regex;
-        int flags = REG_EXTENDED | REG_NOSUB;
-#ifdef REG_NEWLINE
-        if (opts->multiline_mode)
-            flags |= REG_NEWLINE;
-#endif
-#ifdef REG_ICASE
-        if (opts->case_insensitive)
-            flags |= REG_ICASE;
-#endif
+        memcpy(m->tags + used, name, n + 1);
+        used += n + 1;
+        m->tag_count++;
+    }
+    free(name);
+    return 1;
+}
 
-        /* Build pattern with optional word boundary wrapping */
-        size_t patlen = strlen(opts->pattern);
-        size_t need = patlen + 16; /* room for \b .. \b and NUL */
-        if (need > MAX_SEARCH_LEN * 4)
-        {
-            /* pattern too large */
-            return 0;
-        }
+/* ------------ Prepared queries -------------- */
 
-        char *pattern_buf = malloc(need);
-        if (!pattern_buf)
-            return 0;
+/* Compile opts into a reusable matcher. The matcher does not reference opts
+ * afterwards. Returns NULL only on allocation failure. */
+cn_matcher *cn_matcher_compile(const cn_search_opts *opts)
+{
+    if (!opts)
+        return NULL;
 
-        if (opts->word_boundary)
-        {
-            /* wrap with word boundary tokens (\b), which need escaping in C string */
-            int rc = snprintf(pattern_buf, need, "\\b%s\\b", opts->pattern);
-            if (rc < 0 || (size_t)rc >= need)
-            {
-                free(pattern_buf);
-                return 0;
-            }
-        }
-        else
+    cn_matcher *m = calloc(1, sizeof(*m));
+    if (!m)
+        return NULL;
+
+    if (opts->pattern && *opts->pattern)
+    {
+        m->has_pattern = 1;
+        m->regex_mode = opts->regex_mode;
+        m->exact_match = opts->exact_match;
+
+        if (opts->regex_mode)
         {
-            /* copy pattern safely */
-            if (patlen + 1 > need)
-            {
-                free(pattern_buf);
-                return 0;
-            }
-            strcpy(pattern_buf, opts->pattern);
+            m->regex = compile_regex(opts);
         }
-
-        /* compile */
-        if (regcomp(&regex, pattern_buf, flags) != 0)
+        else if (!cn_finder_init(&m->pattern, opts->pattern, strlen(opts->pattern),
+                                 opts->case_insensitive))
         {
-            free(pattern_buf);
-            return 0;
+            cn_matcher_free(m);
+            return NULL;
         }
+    }
 
-        int matched = 0;
-        /* try title */
-        if (regexec(&regex, note->title, 0, NULL, 0) == 0)
-            matched = 1;
-        /* try content */
-        else if (regexec(&regex, note->content, 0, NULL, 0) == 0)
-            matched = 1;
-        /* try tags */
-        else if (regexec(&regex, note->tags, 0, NULL, 0) == 0)
-            matched = 1;
-
-        regfree(&regex);
-        free(pattern_buf);
-        return matched ? 1 : 0;
+    if (opts->tags && *opts->tags && !compile_tags(m, opts->tags))
+    {
+        cn_matcher_free(m);
+        return NULL;
     }
+    return m;
+}
 
-    /* NON-REGEX MODE (substring/exact) */
-    const char *search = opts->pattern;
-    char *title_copy = NULL;
-    char *content_copy = NULL;
-    char *tags_copy = NULL;
-    char *search_copy = NULL;
+void cn_matcher_free(cn_matcher *m)
+{
+    if (!m)
+        return;
+    cn_re_free(m->regex);
+    cn_finder_free(&m->pattern);
+    free(m->tags);
+    free(m);
+}
 
-    if (opts->case_insensitive)
+/* Whether the note's tags include the normalized tag `want` */
+static int has_tag(const char *note_tags, size_t note_len, const char *want)
+{
+    char name[MAX_TAGS_LEN];
+    size_t pos = 0;
+    while (cn_tag_next(note_tags, note_len, &pos, name) > 0)
     {
-        /* allocate lowercased copies */
-        size_t title_len = strlen(note->title);
-        size_t content_len = strlen(note->content);
-        size_t tags_len = strlen(note->tags);
-        size_t search_len = strlen(search);
-
-        /* Bounds sanity */
-        if (title_len > MAX_CONTENT_LEN || content_len > MAX_CONTENT_LEN || tags_len > MAX_TAGS_LEN || search_len > MAX_SEARCH_LEN)
-        {
-            /* refuse very large inputs to avoid surprises */
-            return 0;
-        }
+        if (strcmp(name, want) == 0)
+            return 1;
+    }
+    return 0;
+}
 
-        title_copy = malloc(title_len + 1);
-        content_copy = malloc(content_len + 1);
-        tags_copy = malloc(tags_len + 1);
-        search_copy = malloc(search_len + 1);
-        if (!title_copy || !content_copy || !tags_copy || !search_copy)
-        {
-            free(title_copy);
-            free(content_copy);
-            free(tags_copy);
-            free(search_copy);
-            return 0;
-        }
+/* Tag part of the query: every filter tag must be one of the note's tags */
+static int match_tags(const cn_matcher *m, const char *note_tags, size_t note_len)
+{
+    if (m->tag_count == 0)
+        return 1; /* no tag filter => match */
+
+    if (!note_tags || note_len == 0)
+        return 0; /* note has no tags but search requires some */
+
+    if (note_len >= MAX_TAGS_LEN)
+        return 0;
 
-        strcpy(title_copy, note->title);
-        strcpy(content_copy, note->content);
-        strcpy(tags_copy, note->tags);
-        strcpy(search_copy, search);
-
-        for (char *p = title_copy; *p; ++p)
-            *p = (char)tolower((unsigned char)*p);
-        for (char *p = content_copy; *p; ++p)
-            *p = (char)tolower((unsigned char)*p);
-        for (char *p = tags_copy; *p; ++p)
-            *p = (char)tolower((unsigned char)*p);
-        for (char *p = search_copy; *p; ++p)
-            *p = (char)tolower((unsigned char)*p);
-
-        /* redirect pointers to lowercase buffers */
-        search = search_copy;
+    const char *want = m->tags;
+    for (size_t i = 0; i < m->tag_count; ++i)
+    {
+        if (!has_tag(note_tags, note_len, want))
+            return 0;
+        want += strlen(want) + 1;
     }
+    return 1;
+}
 
-    const char *title = title_copy ? title_copy : note->title;
-    const char *content = content_copy ? content_copy : note->content;
-    const char *tags = tags_copy ? tags_copy : note->tags;
+/* Content part of the query against title, content and tags. Returns 1,
+ * 0, or -1 if a regex search ran out of memory. */
+static int match_content(const cn_matcher *m, const cn_note_view *note)
+{
+    if (!m->has_pattern)
+        return 1; /* nothing to search => matches */
 
-    int matched = 0;
-    if (opts->exact_match)
+    /* REGEX MODE */
+    if (m->regex_mode)
     {
-        if (strcmp(title, search) == 0 || strcmp(content, search) == 0 || strcmp(tags, search) == 0)
-            matched = 1;
+        if (!m->regex)
+            return 0;
+        int rc = cn_re_search(m->regex, note->title, note->title_len);
+        if (rc == 0)
+            rc = cn_re_search(m->regex, note->content, note->content_len);
+        if (rc == 0)
+            rc = cn_re_search(m->regex, note->tags, note->tags_len);
+        return rc;
     }
-    else
+
+    /* NON-REGEX MODE (substring/exact), folding in place when case-insensitive */
+    const cn_finder *f = &m->pattern;
+    if (m->exact_match)
     {
-        if (strstr(title, search) != NULL || strstr(content, search) != NULL || strstr(tags, search) != NULL)
-            matched = 1;
+        return cn_finder_equals(f, note->title, note->title_len) ||
+               cn_finder_equals(f, note->content, note->content_len) ||
+               cn_finder_equals(f, note->tags, note->tags_len);
     }
+    return cn_finder_find(f, note->title, note->title_len) != NULL ||
+           cn_finder_find(f, note->content, note->content_len) != NULL ||
+           cn_finder_find(f, note->tags, note->tags_len) != NULL;
+}
 
-    free(title_copy);
-    free(content_copy);
-    free(tags_copy);
-    free(search_copy);
+/* Returns 1 if note satisfies both the content query and the tag filter,
+ * 0 if not, -1 on allocation failure. Safe to call concurrently on one
+ * matcher; never calls cn_error_exit, so scan workers can use it. */
+int cn_matcher_match(const cn_matcher *m, const cn_note_view *note)
+{
+    if (!m || !note)
+        return 0;
+    int rc = match_content(m, note);
+    if (rc <= 0)
+        return rc;
+    return match_tags(m, note->tags, note->tags_len);
+}
+
+/* ------------ One-shot helpers -------------- */
 
-    return matched ? 1 : 0;
+/* Exact match of every normalized tag of search_tags.
+ * Returns 1 if search_tags is NULL/empty (match-all), 0 otherwise.
+ */
+int cn_note_match_tags(const char *note_tags, const char *search_tags)
+{
+    if (!search_tags || !*search_tags)
+        return 1; /* no tag filter => match */
+
+    if (strlen(search_tags) >= MAX_TAGS_LEN)
+        return 0;
+
+    cn_search_opts opts = {0};
+    opts.tags = search_tags;
+    cn_matcher *m = cn_matcher_compile(&opts);
+    if (!m)
+        return 0;
+    int matched = match_tags(m, note_tags, note_tags ? strlen(note_tags) : 0);
+    cn_matcher_free(m);
+    return matched;
+}
+
+/* Returns 1 if note matches the search options, 0 otherwise.
+ * opts->pattern may be NULL or empty => match-all.
+ * Compiles the query on every call; use cn_matcher_* in loops.
+ */
+int cn_note_match_content(const cn_note_view *note, const cn_search_opts *opts)
+{
+    if (!note || !opts)
+        return 0;
+
+    if (!opts->pattern || !*opts->pattern)
+        return 1; /* nothing to search => matches */
+
+    cn_search_opts content_only = *opts;
+    content_only.tags = NULL;
+    cn_matcher *m = cn_matcher_compile(&content_only);
+    if (!m)
+        return 0;
+    int matched = match_content(m, note);
+    cn_matcher_free(m);
+    if (matched < 0)
+        cn_error_exit("Failed to allocate memory for regex search");
+    return matched;
 }
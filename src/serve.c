@@ -0,0 +1,534 @@
+/*
+ * src/serve.c
+ *
+ * Daemon mode: `cheatnote serve` keeps the database loaded in memory and
+ * runs commands sent by the CLI over a Unix domain socket, "<db>.sock".
+ *
+ * - Every CLI invocation first tries to connect to the socket. If a daemon
+ *   answers, the CLI sends its command line, working directory and color
+ *   setting, passing its stdin/stdout/stderr along (SCM_RIGHTS). The daemon
+ *   puts those descriptors on fds 0-2 and runs the command through the
+ *   normal dispatcher, so output goes straight to the caller's terminal or
+ *   pipe; only the exit code travels back. With no daemon (no socket, or a
+ *   stale one) the CLI runs the command itself, as before.
+ * - Mutations still go through cn_db_commit_* (journal, lock), so the files
+ *   remain the source of truth and plain CLI processes (`--no-daemon`, other
+ *   users of the files) can run alongside. Before each request the daemon
+ *   picks up their commits with cn_db_refresh.
+ * - cn_error_exit longjmps back here instead of exiting. The database is
+ *   then reloaded from disk, as after any failed mutating command, so a
+ *   half-applied in-memory change never outlives its request.
+ * - Requests are served one at a time; a client has SERVE_TIMEOUT_S to
+ *   send its request. The socket is created mode 0600.
+ *
+ * Request (host byte order; the socket is local):
+ *
+ *   header : u32 magic "CNSV" | u32 version | u32 flags (bit0 colors)
+ *            | u32 argc | u32 payload_len, with the 3 descriptors attached
+ *   payload: cwd\0 argv[0]\0 ... argv[argc-1]\0
+ *
+ * Reply: i32 exit code.
+ *
+ * Not available on Windows: serve fails and the CLI always runs locally.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "cheatnote.h"
+#include "serve.h"
+#include "commands.h"
+#include "db.h"
+#include "display.h"
+#include "index.h"
+#include "lock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#endif
+
+#define SERVE_MAGIC 0x56534e43u /* "CNSV" read as little-endian u32 */
+#define SERVE_VERSION 1u
+#define SERVE_COLORS 1u
+#define SERVE_MAX_PAYLOAD (1u << 20)
+#define SERVE_MAX_ARGS 4096u
+#define SERVE_TIMEOUT_S 5
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* SIGPIPE is ignored by the daemon anyway */
+#endif
+
+typedef struct serve_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t argc;
+    uint32_t payload_len;
+} serve_header;
+
+static jmp_buf request_jmp;
+static volatile sig_atomic_t stop_requested;
+static int serving;
+static char bound_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+/* "<db>.sock" for the current database. Returns 0 if it does not fit. */
+static int socket_path(struct sockaddr_un *addr)
+{
+    const char *path = cn_get_db_path();
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (!path || path[0] == '\0')
+        return 0;
+    int n = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s.sock", path);
+    return n > 0 && (size_t)n < sizeof(addr->sun_path);
+}
+
+static int read_full(int fd, void *buf, size_t len)
+{
+    unsigned char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int send_full(int fd, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+/* ------------------------------------------------------------
+ * Daemon
+ * ------------------------------------------------------------*/
+
+/* Reached only from the thread running the request: scan workers report
+ * failures to it instead of calling cn_error_exit (scan.c) */
+static void on_error(void)
+{
+    longjmp(request_jmp, 1);
+}
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void remove_socket(void)
+{
+    if (bound_path[0])
+        (void)unlink(bound_path);
+    bound_path[0] = '\0';
+}
+
+/* Receive a request header with its descriptors, then the payload.
+ * Every descriptor received ends up in fds (closed by the caller) or is
+ * closed here. Returns 0 on a malformed or truncated request. */
+static int recv_request(int conn, serve_header *hdr, int fds[3], char **payload)
+{
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+    } ctl;
+    struct iovec iov = {hdr, sizeof(*hdr)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    ssize_t n;
+    do
+        n = recvmsg(conn, &msg, 0);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return 0;
+
+    int got = 0;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+    {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+            continue;
+        size_t k = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < k; ++i)
+        {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(fd));
+            if (got < 3)
+                fds[got++] = fd;
+            else
+                close(fd);
+        }
+    }
+    if (got != 3 || (msg.msg_flags & MSG_CTRUNC))
+        return 0;
+
+    if ((size_t)n < sizeof(*hdr) &&
+        !read_full(conn, (unsigned char *)hdr + n, sizeof(*hdr) - (size_t)n))
+        return 0;
+    if (hdr->magic != SERVE_MAGIC || hdr->version != SERVE_VERSION || hdr->argc == 0 ||
+        hdr->argc > SERVE_MAX_ARGS || hdr->payload_len == 0 ||
+        hdr->payload_len > SERVE_MAX_PAYLOAD)
+        return 0;
+
+    *payload = malloc(hdr->payload_len);
+    return *payload && read_full(conn, *payload, hdr->payload_len);
+}
+
+/* Split the payload into cwd and argc arguments, NULL-terminating argv.
+ * Returns 0 unless it holds exactly argc + 1 strings. */
+static int split_payload(char *p, size_t len, uint32_t argc, char **cwd, char **argv)
+{
+    const char *end = p + len;
+    if (p[len - 1] != '\0')
+        return 0;
+    *cwd = p;
+    p += strlen(p) + 1;
+    for (uint32_t i = 0; i < argc; ++i)
+    {
+        if (p >= end)
+            return 0;
+        argv[i] = p;
+        p += strlen(p) + 1;
+    }
+    argv[argc] = NULL;
+    return p == end;
+}
+
+/* Run one command line against the resident database. Returns its exit
+ * code; any error (cn_error_exit) comes back here as EXIT_FAILURE. */
+static int run_command(int argc, char **argv)
+{
+    const char *cmd = argc > 1 ? argv[1] : NULL;
+    volatile int rc = EXIT_FAILURE;
+    volatile int failed = 0;
+
+    if (setjmp(request_jmp) == 0)
+    {
+        cn_set_error_handler(on_error);
+        /* lock before refreshing, as main.c locks before loading: a
+         * commit slipping in between would be lost by the rewrite */
+        if (cn_command_rewrites_db(cmd))
+            (void)cn_db_lock(CN_LOCK_EXCLUSIVE);
+        cn_db_refresh();
+        rc = cn_commands_dispatch(argc, argv);
+    }
+    else
+    {
+        failed = 1;
+    }
+    cn_set_error_handler(NULL);
+    cn_db_lock_restore(CN_LOCK_NONE);
+
+    if (failed || (rc != 0 && !cn_command_is_readonly(cmd)))
+    {
+        /* memory may hold a change that never reached the journal */
+        cn_db_defer_commits(0);
+        cn_index_close();
+        cn_db_cleanup();
+        cn_db_load();
+    }
+    return failed ? EXIT_FAILURE : rc;
+}
+
+static void serve_connection(int conn, const int saved[3])
+{
+    serve_header hdr;
+    int fds[3] = {-1, -1, -1};
+    char *payload = NULL;
+    char **argv = NULL;
+    char *cwd = NULL;
+    int32_t rc = EXIT_FAILURE;
+
+    if (!recv_request(conn, &hdr, fds, &payload))
+        goto done;
+    argv = malloc(((size_t)hdr.argc + 1) * sizeof(*argv));
+    if (!argv || !split_payload(payload, hdr.payload_len, hdr.argc, &cwd, argv))
+        goto done;
+
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < 3; ++i)
+        (void)dup2(fds[i], i);
+
+    if (chdir(cwd) != 0)
+    {
+        fprintf(stderr, "Error: Cannot change to working directory %s\n", cwd);
+    }
+    else
+    {
+        use_colors = (hdr.flags & SERVE_COLORS) != 0;
+        rc = run_command((int)hdr.argc, argv);
+    }
+
+    /* the client may have gone away: its errors must not stick to stdout */
+    fflush(stdout);
+    fflush(stderr);
+    clearerr(stdout);
+    clearerr(stderr);
+    for (int i = 0; i < 3; ++i)
+        (void)dup2(saved[i], i);
+    (void)send_full(conn, &rc, sizeof(rc));
+
+done:
+    for (int i = 0; i < 3; ++i)
+    {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+    free(argv);
+    free(payload);
+}
+
+/* Commands run in the callers' directories: pin the database path first */
+static void make_db_path_absolute(void)
+{
+    const char *path = cn_get_db_path();
+    char cwd[PATH_MAX], abs[PATH_MAX];
+    if (!path || path[0] == '\0' || path[0] == '/' || !getcwd(cwd, sizeof(cwd)))
+        return;
+    int n = snprintf(abs, sizeof(abs), "%s/%s", cwd, path);
+    if (n > 0 && (size_t)n < sizeof(abs))
+        cn_set_db_path(abs);
+}
+
+int cn_serve_run(void)
+{
+    if (serving)
+        cn_error_exit("Already serving this database");
+
+    make_db_path_absolute();
+    struct sockaddr_un addr;
+    if (!socket_path(&addr))
+        cn_error_exit("Database path too long for its socket (<db>.sock)");
+
+    /* A socket nobody answers on is left over from a daemon that died */
+    struct stat st;
+    if (lstat(addr.sun_path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+            cn_error_exit("Socket path exists and is not a socket");
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        int alive = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        if (probe >= 0)
+            close(probe);
+        if (alive)
+            cn_error_exit("A cheatnote daemon is already serving this database");
+        (void)unlink(addr.sun_path);
+    }
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0)
+        cn_error_exit("Failed to create socket");
+    (void)fcntl(lfd, F_SETFD, FD_CLOEXEC);
+    mode_t old_mask = umask(077);
+    int bound = bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(old_mask);
+    if (!bound || listen(lfd, 64) != 0)
+    {
+        close(lfd);
+        cn_error_exit("Failed to listen on socket");
+    }
+    memcpy(bound_path, addr.sun_path, sizeof(bound_path));
+    if (atexit(remove_socket) != 0)
+        fprintf(stderr, "Warning: failed to register cleanup handler\n");
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal; /* no SA_RESTART: accept() returns EINTR */
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+
+    int saved[3];
+    for (int i = 0; i < 3; ++i)
+        saved[i] = fcntl(i, F_DUPFD_CLOEXEC, 3);
+
+    char msg[PATH_MAX + 64];
+    snprintf(msg, sizeof(msg), "Serving %zu notes on %s", db.count, addr.sun_path);
+    cn_info_msg(msg);
+    fflush(stdout);
+
+    serving = 1;
+    while (!stop_requested)
+    {
+        int conn = accept(lfd, NULL, NULL);
+        if (conn < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            cn_error_exit("Failed to accept connection");
+        }
+        (void)fcntl(conn, F_SETFD, FD_CLOEXEC);
+        struct timeval tv = {SERVE_TIMEOUT_S, 0};
+        (void)setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        serve_connection(conn, saved);
+        close(conn);
+    }
+    serving = 0;
+
+    close(lfd);
+    remove_socket();
+    for (int i = 0; i < 3; ++i)
+    {
+        if (saved[i] >= 0)
+            close(saved[i]);
+    }
+    cn_info_msg("Stopped serving");
+    return 0;
+}
+
+/* ------------------------------------------------------------
+ * Client
+ * ------------------------------------------------------------*/
+
+int cn_serve_forward(int argc, char *argv[], int *rc)
+{
+    struct sockaddr_un addr;
+    if (argc < 1 || (uint32_t)argc > SERVE_MAX_ARGS || !socket_path(&addr))
+        return 0;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return 0;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd); /* no daemon (or a stale socket): run locally */
+        return 0;
+    }
+
+    char cwd[PATH_MAX];
+    size_t len = 0;
+    char *payload = NULL;
+    if (getcwd(cwd, sizeof(cwd)))
+    {
+        len = strlen(cwd) + 1;
+        for (int i = 0; i < argc; ++i)
+            len += strlen(argv[i]) + 1;
+        if (len <= SERVE_MAX_PAYLOAD)
+            payload = malloc(len);
+    }
+    if (!payload)
+    {
+        close(fd);
+        return 0;
+    }
+    char *p = payload;
+    size_t n = strlen(cwd) + 1;
+    memcpy(p, cwd, n);
+    p += n;
+    for (int i = 0; i < argc; ++i)
+    {
+        n = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], n);
+        p += n;
+    }
+
+    serve_header hdr = {SERVE_MAGIC, SERVE_VERSION, use_colors ? SERVE_COLORS : 0,
+                        (uint32_t)argc, (uint32_t)len};
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    struct iovec iov = {&hdr, sizeof(hdr)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    /* Until the whole request is out the daemon runs nothing (it drops
+     * truncated requests), so falling back to local execution is safe */
+    ssize_t sent;
+    do
+        sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    while (sent < 0 && errno == EINTR);
+    int ok = sent > 0 &&
+             send_full(fd, (unsigned char *)&hdr + sent, sizeof(hdr) - (size_t)sent) &&
+             send_full(fd, payload, len);
+    free(payload);
+    if (!ok)
+    {
+        close(fd);
+        return 0;
+    }
+
+    int32_t code;
+    if (!read_full(fd, &code, sizeof(code)))
+    {
+        close(fd);
+        cn_error_exit("Lost connection to the cheatnote daemon");
+    }
+    close(fd);
+    *rc = code;
+    return 1;
+}
+
+#else /* Windows: no daemon */
+
+int cn_serve_run(void)
+{
+    cn_error_exit("serve is not supported on this platform");
+    return 1;
+}
+
+int cn_serve_forward(int argc, char *argv[], int *rc)
+{
+    (void)argc;
+    (void)argv;
+    (void)rc;
+    return 0;
+}
+
+#endif
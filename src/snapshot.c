@@ -0,0 +1,402 @@
+/*
+ * src/snapshot.c
+ *
+ * Binary snapshots for `export --format=bin` / `import`.
+ *
+ * Unlike the database file, a snapshot is portable: every integer is
+ * little-endian and written byte by byte, so a backup taken on one machine
+ * restores on any other.
+ *
+ *   header : magic "CNBK" | u32 version | u32 flags | u32 count
+ *            | u32 next_id | u32 block_size | u64 payload_len
+ *            | u32 reserved | u32 header_crc            (40 bytes)
+ *   blocks : u32 raw_len | u32 stored_len | u32 crc | stored bytes
+ *            ... ended by a block with raw_len 0
+ *
+ * The payload is the concatenation of every block's raw bytes, cut into
+ * block_size pieces regardless of record boundaries:
+ *
+ *   record : u32 id | u32 title_len | u32 content_len | u32 tags_len
+ *            | i64 created | i64 modified | title\0 content\0 tags\0
+ *
+ * A block is stored LZ-compressed (lz.c) when the CN_SNAPSHOT_LZ flag is
+ * set and compression saved space, raw otherwise (stored_len == raw_len).
+ * crc is the CRC-32 of the raw bytes, so corruption is caught per block
+ * before any note is touched.
+ *
+ * Reading allocates the payload once (its size is in the header): raw
+ * blocks are read straight into place, compressed ones are decoded into
+ * place from one scratch buffer. Records are then handed out as views into
+ * the payload, with no per-field parsing or copying.
+ */
+
+#include "snapshot.h"
+#include "db.h"
+#include "export.h"
+#include "lz.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_HEADER_SIZE 32u
+#define MAX_BLOCK_SIZE (64u << 20) /* larger block_size values are corrupt */
+
+/* ------------ Little-endian fields -------------- */
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const unsigned char *p)
+{
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+/* ------------ CRC-32 -------------- */
+
+/* Slicing-by-8 tables: crc_table[k][b] is the CRC of byte b followed by
+ * k zero bytes, so eight input bytes are folded per step */
+static uint32_t crc_table[8][256];
+static int crc_ready;
+
+static void crc_init(void)
+{
+    for (uint32_t b = 0; b < 256; ++b)
+    {
+        uint32_t c = b;
+        for (int k = 0; k < 8; ++k)
+            c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+        crc_table[0][b] = c;
+    }
+    for (uint32_t b = 0; b < 256; ++b)
+    {
+        for (int k = 1; k < 8; ++k)
+            crc_table[k][b] = (crc_table[k - 1][b] >> 8) ^ crc_table[0][crc_table[k - 1][b] & 0xFF];
+    }
+    crc_ready = 1;
+}
+
+uint32_t cn_crc32(uint32_t crc, const void *data, size_t len)
+{
+    if (!crc_ready)
+        crc_init();
+
+    const unsigned char *p = data;
+    crc = ~crc;
+    while (len >= 8)
+    {
+        uint32_t lo = get_u32(p) ^ crc;
+        uint32_t hi = get_u32(p + 4);
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+/* ------------ Writer -------------- */
+
+static size_t record_size(const cn_note_view *note)
+{
+    return RECORD_HEADER_SIZE + note->title_len + note->content_len + note->tags_len + 3;
+}
+
+static void put_record(cn_outbuf *b, const cn_note_view *note)
+{
+    unsigned char hdr[RECORD_HEADER_SIZE];
+    put_u32(hdr, note->id);
+    put_u32(hdr + 4, (uint32_t)note->title_len);
+    put_u32(hdr + 8, (uint32_t)note->content_len);
+    put_u32(hdr + 12, (uint32_t)note->tags_len);
+    put_u64(hdr + 16, (uint64_t)(int64_t)note->created_at);
+    put_u64(hdr + 24, (uint64_t)(int64_t)note->modified_at);
+    cn_outbuf_put(b, hdr, sizeof(hdr));
+    cn_outbuf_put(b, note->title, note->title_len + 1);
+    cn_outbuf_put(b, note->content, note->content_len + 1);
+    cn_outbuf_put(b, note->tags, note->tags_len + 1);
+}
+
+/* Write one block of raw payload, compressed into scratch if that helps */
+static int write_block(FILE *out, const unsigned char *raw, size_t len,
+                       unsigned char *scratch, size_t scratch_cap)
+{
+    const unsigned char *stored = raw;
+    size_t stored_len = len;
+    if (scratch)
+    {
+        size_t clen = cn_lz_compress(raw, len, scratch, scratch_cap);
+        if (clen > 0 && clen < len)
+        {
+            stored = scratch;
+            stored_len = clen;
+        }
+    }
+
+    unsigned char hdr[12];
+    put_u32(hdr, (uint32_t)len);
+    put_u32(hdr + 4, (uint32_t)stored_len);
+    put_u32(hdr + 8, cn_crc32(0, raw, len));
+    return fwrite(hdr, 1, sizeof(hdr), out) == sizeof(hdr) &&
+           fwrite(stored, 1, stored_len, out) == stored_len;
+}
+
+int cn_snapshot_write(FILE *out, int compress)
+{
+    /* The payload size goes in the header, so the file can be written in
+     * one pass (even to a pipe) and read back with one allocation */
+    uint64_t payload_len = 0;
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        cn_note_view note;
+        cn_db_note_view(i, &note);
+        payload_len += record_size(&note);
+    }
+
+    unsigned char hdr[CN_SNAPSHOT_HEADER_SIZE];
+    memcpy(hdr, CN_SNAPSHOT_MAGIC, 4);
+    put_u32(hdr + 4, CN_SNAPSHOT_VERSION);
+    put_u32(hdr + 8, compress ? CN_SNAPSHOT_LZ : 0);
+    put_u32(hdr + 12, (uint32_t)db.count);
+    put_u32(hdr + 16, db.next_id);
+    put_u32(hdr + 20, CN_SNAPSHOT_BLOCK_SIZE);
+    put_u64(hdr + 24, payload_len);
+    put_u32(hdr + 32, 0);
+    put_u32(hdr + 36, cn_crc32(0, hdr, 36));
+    if (fwrite(hdr, 1, sizeof(hdr), out) != sizeof(hdr))
+        return 0;
+
+    size_t scratch_cap = CN_LZ_BOUND(CN_SNAPSHOT_BLOCK_SIZE);
+    unsigned char *scratch = compress ? malloc(scratch_cap) : NULL;
+    cn_outbuf b;
+    cn_outbuf_init(&b, NULL);
+    int ok = 1;
+
+    for (size_t i = 0; ok && i <= db.count; ++i)
+    {
+        if (i < db.count)
+        {
+            cn_note_view note;
+            cn_db_note_view(i, &note);
+            put_record(&b, &note);
+            if (b.error)
+            {
+                ok = 0;
+                break;
+            }
+        }
+
+        /* Cut full blocks; the tail waits for more records (or the end) */
+        size_t done = 0;
+        while (ok && (b.len - done >= CN_SNAPSHOT_BLOCK_SIZE || (i == db.count && done < b.len)))
+        {
+            size_t len = b.len - done < CN_SNAPSHOT_BLOCK_SIZE ? b.len - done : CN_SNAPSHOT_BLOCK_SIZE;
+            ok = write_block(out, (const unsigned char *)b.data + done, len, scratch, scratch_cap);
+            done += len;
+        }
+        if (done > 0)
+        {
+            memmove(b.data, b.data + done, b.len - done);
+            b.len -= done;
+        }
+    }
+
+    if (ok)
+    {
+        unsigned char end[12] = {0};
+        ok = fwrite(end, 1, sizeof(end), out) == sizeof(end);
+    }
+    cn_outbuf_free(&b);
+    free(scratch);
+    return ok && fflush(out) == 0;
+}
+
+/* ------------ Reader -------------- */
+
+int cn_snapshot_detect(FILE *f)
+{
+    char magic[4];
+    size_t n = fread(magic, 1, sizeof(magic), f);
+    rewind(f);
+    return n == sizeof(magic) && memcmp(magic, CN_SNAPSHOT_MAGIC, 4) == 0;
+}
+
+void cn_snapshot_free(cn_snapshot *s)
+{
+    free(s->payload);
+    memset(s, 0, sizeof(*s));
+}
+
+/* Check every record's framing once, so cn_snapshot_next can trust it */
+static int verify_records(const cn_snapshot *s)
+{
+    size_t pos = 0;
+    for (size_t i = 0; i < s->count; ++i)
+    {
+        if (s->payload_len - pos < RECORD_HEADER_SIZE)
+            return 0;
+        const unsigned char *r = s->payload + pos;
+        uint32_t id = get_u32(r);
+        size_t tl = get_u32(r + 4), cl = get_u32(r + 8), gl = get_u32(r + 12);
+        if (id == 0 || tl >= MAX_TITLE_LEN || cl >= MAX_CONTENT_LEN || gl >= MAX_TAGS_LEN)
+            return 0;
+
+        size_t body = tl + cl + gl + 3;
+        if (s->payload_len - pos - RECORD_HEADER_SIZE < body)
+            return 0;
+        const unsigned char *t = r + RECORD_HEADER_SIZE;
+        if (t[tl] != '\0' || t[tl + 1 + cl] != '\0' || t[tl + 1 + cl + 1 + gl] != '\0')
+            return 0;
+        pos += RECORD_HEADER_SIZE + body;
+    }
+    return pos == s->payload_len;
+}
+
+int cn_snapshot_read(FILE *f, cn_snapshot *s, const char **err)
+{
+    memset(s, 0, sizeof(*s));
+    unsigned char *scratch = NULL;
+
+    unsigned char hdr[CN_SNAPSHOT_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || memcmp(hdr, CN_SNAPSHOT_MAGIC, 4) != 0)
+    {
+        *err = "not a snapshot file";
+        return 0;
+    }
+    if (get_u32(hdr + 36) != cn_crc32(0, hdr, 36))
+    {
+        *err = "snapshot header is corrupt";
+        return 0;
+    }
+    if (get_u32(hdr + 4) != CN_SNAPSHOT_VERSION)
+    {
+        *err = "unsupported snapshot version";
+        return 0;
+    }
+
+    s->flags = get_u32(hdr + 8);
+    s->count = get_u32(hdr + 12);
+    s->next_id = get_u32(hdr + 16);
+    size_t block_size = get_u32(hdr + 20);
+    uint64_t payload_len = get_u64(hdr + 24);
+    uint64_t max_payload = (uint64_t)s->count *
+                           (RECORD_HEADER_SIZE + MAX_TITLE_LEN + MAX_CONTENT_LEN + MAX_TAGS_LEN);
+    if (s->count > MAX_NOTES || payload_len > max_payload || block_size == 0 ||
+        block_size > MAX_BLOCK_SIZE || (s->flags & ~CN_SNAPSHOT_LZ) != 0)
+    {
+        *err = "snapshot header is corrupt";
+        return 0;
+    }
+
+    /* The one allocation that holds every note */
+    s->payload_len = (size_t)payload_len;
+    s->payload = malloc(s->payload_len ? s->payload_len : 1);
+    if ((s->flags & CN_SNAPSHOT_LZ) != 0)
+        scratch = malloc(block_size);
+    if (!s->payload || ((s->flags & CN_SNAPSHOT_LZ) != 0 && !scratch))
+    {
+        *err = "out of memory";
+        goto fail;
+    }
+
+    size_t pos = 0;
+    for (;;)
+    {
+        unsigned char bh[12];
+        if (fread(bh, 1, sizeof(bh), f) != sizeof(bh))
+        {
+            *err = "snapshot is truncated";
+            goto fail;
+        }
+        size_t raw_len = get_u32(bh), stored_len = get_u32(bh + 4);
+        uint32_t crc = get_u32(bh + 8);
+        if (raw_len == 0)
+            break;
+
+        if (raw_len > block_size || raw_len > s->payload_len - pos || stored_len > raw_len ||
+            (stored_len < raw_len && !scratch))
+        {
+            *err = "snapshot block is corrupt";
+            goto fail;
+        }
+
+        unsigned char *dst = s->payload + pos;
+        if (stored_len == raw_len)
+        {
+            if (fread(dst, 1, raw_len, f) != raw_len)
+            {
+                *err = "snapshot is truncated";
+                goto fail;
+            }
+        }
+        else
+        {
+            if (fread(scratch, 1, stored_len, f) != stored_len)
+            {
+                *err = "snapshot is truncated";
+                goto fail;
+            }
+            if (cn_lz_decompress(scratch, stored_len, dst, raw_len) != raw_len)
+            {
+                *err = "snapshot block is corrupt";
+                goto fail;
+            }
+        }
+        if (cn_crc32(0, dst, raw_len) != crc)
+        {
+            *err = "snapshot checksum mismatch";
+            goto fail;
+        }
+        pos += raw_len;
+    }
+
+    if (pos != s->payload_len || !verify_records(s))
+    {
+        *err = "snapshot records are corrupt";
+        goto fail;
+    }
+    free(scratch);
+    return 1;
+
+fail:
+    free(scratch);
+    cn_snapshot_free(s);
+    return 0;
+}
+
+int cn_snapshot_next(cn_snapshot *s, cn_note_view *note)
+{
+    if (s->pos >= s->payload_len)
+        return 0;
+    const unsigned char *r = s->payload + s->pos;
+    note->id = get_u32(r);
+    note->title_len = get_u32(r + 4);
+    note->content_len = get_u32(r + 8);
+    note->tags_len = get_u32(r + 12);
+    note->created_at = (time_t)(int64_t)get_u64(r + 16);
+    note->modified_at = (time_t)(int64_t)get_u64(r + 24);
+    note->title = (const char *)r + RECORD_HEADER_SIZE;
+    note->content = note->title + note->title_len + 1;
+    note->tags = note->content + note->content_len + 1;
+    s->pos += RECORD_HEADER_SIZE + note->title_len + note->content_len + note->tags_len + 3;
+    return 1;
+}
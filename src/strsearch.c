@@ -0,0 +1,306 @@
+/*
+ * src/strsearch.c
+ *
+ * Substring search kernels used by search.c.
+ *
+ * - cn_finder_init / cn_finder_free : prepare a needle once per query and
+ *                      pick a scan kernel for this CPU
+ * - cn_finder_find   : first occurrence of the needle in a haystack
+ * - cn_finder_equals : whole-field comparison for exact-match mode
+ *
+ * Kernels:
+ * - scalar : Boyer-Moore-Horspool (memchr for single bytes)
+ * - SSE2 / AVX2 : compare 16/32 haystack positions at a time against the
+ *   needle's first and last byte and verify only the positions where both
+ *   hit. On x86-64 SSE2 is always present; AVX2 is chosen at runtime via
+ *   cpuid, so the binary stays portable. Other targets use the scalar path.
+ *
+ * In case-insensitive mode the needle is stored folded and haystack bytes
+ * (scalar and vector) are folded while comparing, so no lowercased copies
+ * of note text are ever made. Folding is ASCII-only, which is exactly
+ * tolower() in the C locale the CLI runs in. The haystack does not need to
+ * be NUL-terminated and is never read past hay_len.
+ */
+
+#include "strsearch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CN_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* ASCII fold without a branch on the common path */
+static inline unsigned char fold(unsigned char c)
+{
+    return (unsigned char)(c | (((unsigned)(c - 'A') < 26u) << 5));
+}
+
+/* Compare needle bytes 1..len-2 at p; the first and last were already checked */
+static inline int verify_middle(const cn_finder *f, const unsigned char *p)
+{
+    const unsigned char *nd = f->needle;
+    size_t n = f->len;
+    if (n <= 2)
+        return 1;
+    if (!f->icase)
+        return memcmp(p + 1, nd + 1, n - 2) == 0;
+    for (size_t k = 1; k + 1 < n; ++k)
+    {
+        if (fold(p[k]) != nd[k])
+            return 0;
+    }
+    return 1;
+}
+
+/* ------------ Scalar kernel -------------- */
+
+static const char *find_scalar(const cn_finder *f, const unsigned char *hay, size_t hay_len)
+{
+    const unsigned char *nd = f->needle;
+    size_t n = f->len;
+    if (n == 1 && !f->icase)
+        return memchr(hay, nd[0], hay_len);
+
+    unsigned char last = nd[n - 1];
+    size_t i = 0;
+    while (i + n <= hay_len)
+    {
+        unsigned char c = hay[i + n - 1];
+        unsigned char fc = f->icase ? fold(c) : c;
+        if (fc == last && verify_middle(f, hay + i) &&
+            (f->icase ? fold(hay[i]) : hay[i]) == nd[0])
+            return (const char *)(hay + i);
+        i += f->skip[c];
+    }
+    return NULL;
+}
+
+/* ------------ SIMD kernels -------------- */
+
+#ifdef CN_HAVE_X86_SIMD
+
+/* Fold 16 bytes: 'A'..'Z' are the only bytes that land below -102 after the
+ * bias, and get 0x20 OR-ed in. */
+static inline __m128i fold_sse2(__m128i x)
+{
+    __m128i t = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8((char)(-128 + 26)), t);
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline const char *scan_sse2(const cn_finder *f, const unsigned char *hay,
+                                    size_t hay_len, int icase)
+{
+    size_t n = f->len;
+    const __m128i first = _mm_set1_epi8((char)f->needle[0]);
+    const __m128i last = _mm_set1_epi8((char)f->needle[n - 1]);
+
+    size_t i = 0;
+    for (; i + n - 1 + 16 <= hay_len; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(const void *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(const void *)(hay + i + n - 1));
+        if (icase)
+        {
+            a = fold_sse2(a);
+            b = fold_sse2(b);
+        }
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask)
+        {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (verify_middle(f, hay + pos))
+                return (const char *)(hay + pos);
+            mask &= mask - 1;
+        }
+    }
+
+    /* Fewer than 16 candidate positions left */
+    return find_scalar(f, hay + i, hay_len - i);
+}
+
+static const char *find_sse2(const cn_finder *f, const unsigned char *hay, size_t hay_len)
+{
+    return f->icase ? scan_sse2(f, hay, hay_len, 1) : scan_sse2(f, hay, hay_len, 0);
+}
+
+__attribute__((target("avx2"))) static inline __m256i fold_avx2(__m256i x)
+{
+    __m256i t = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), t);
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2"))) static inline const char *
+scan_avx2(const cn_finder *f, const unsigned char *hay, size_t hay_len, int icase)
+{
+    size_t n = f->len;
+    const __m256i first = _mm256_set1_epi8((char)f->needle[0]);
+    const __m256i last = _mm256_set1_epi8((char)f->needle[n - 1]);
+
+    size_t i = 0;
+    for (; i + n - 1 + 32 <= hay_len; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(const void *)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(const void *)(hay + i + n - 1));
+        if (icase)
+        {
+            a = fold_avx2(a);
+            b = fold_avx2(b);
+        }
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask)
+        {
+            size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (verify_middle(f, hay + pos))
+                return (const char *)(hay + pos);
+            mask &= mask - 1;
+        }
+    }
+
+    /* Fewer than 32 candidate positions left: finish 16 at a time */
+    return scan_sse2(f, hay + i, hay_len - i, icase);
+}
+
+__attribute__((target("avx2"))) static const char *find_avx2(const cn_finder *f,
+                                                             const unsigned char *hay,
+                                                             size_t hay_len)
+{
+    return f->icase ? scan_avx2(f, hay, hay_len, 1) : scan_avx2(f, hay, hay_len, 0);
+}
+
+#endif /* CN_HAVE_X86_SIMD */
+
+/* ------------ Kernel selection -------------- */
+
+static int kernel_supported(int kernel)
+{
+    switch (kernel)
+    {
+    case CN_KERNEL_SCALAR:
+        return 1;
+#ifdef CN_HAVE_X86_SIMD
+    case CN_KERNEL_SSE2:
+        return 1;
+    case CN_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+int cn_finder_set_kernel(cn_finder *f, int kernel)
+{
+    if (kernel == CN_KERNEL_AUTO)
+    {
+        kernel = kernel_supported(CN_KERNEL_AVX2)   ? CN_KERNEL_AVX2
+                 : kernel_supported(CN_KERNEL_SSE2) ? CN_KERNEL_SSE2
+                                                    : CN_KERNEL_SCALAR;
+    }
+    if (!kernel_supported(kernel))
+        return 0;
+
+    f->kernel = kernel;
+    switch (kernel)
+    {
+#ifdef CN_HAVE_X86_SIMD
+    case CN_KERNEL_SSE2:
+        f->find = find_sse2;
+        break;
+    case CN_KERNEL_AVX2:
+        f->find = find_avx2;
+        break;
+#endif
+    default:
+        f->find = find_scalar;
+        break;
+    }
+    return 1;
+}
+
+const char *cn_finder_kernel_name(const cn_finder *f)
+{
+    switch (f->kernel)
+    {
+    case CN_KERNEL_SSE2:
+        return "sse2";
+    case CN_KERNEL_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+/* ------------ Public API -------------- */
+
+int cn_finder_init(cn_finder *f, const char *needle, size_t len, int icase)
+{
+    memset(f, 0, sizeof(*f));
+
+    f->needle = malloc(len + 1);
+    if (!f->needle)
+        return 0;
+    f->len = len;
+    f->icase = icase ? 1 : 0;
+
+    for (size_t i = 0; i < len; ++i)
+        f->needle[i] = icase ? fold((unsigned char)needle[i]) : (unsigned char)needle[i];
+    f->needle[len] = '\0';
+
+    /* Horspool: shift by distance from the last occurrence of a byte in
+     * needle[0..len-1) to the end; bytes not present shift the full length.
+     * For folded needles, both cases of a letter share the folded entry. */
+    for (size_t c = 0; c < 256; ++c)
+        f->skip[c] = len ? len : 1;
+    for (size_t i = 0; i + 1 < len; ++i)
+        f->skip[f->needle[i]] = len - 1 - i;
+    if (icase)
+    {
+        for (int c = 'A'; c <= 'Z'; ++c)
+            f->skip[c] = f->skip[fold((unsigned char)c)];
+    }
+
+    cn_finder_set_kernel(f, CN_KERNEL_AUTO);
+    return 1;
+}
+
+void cn_finder_free(cn_finder *f)
+{
+    free(f->needle);
+    f->needle = NULL;
+    f->len = 0;
+}
+
+const char *cn_finder_find(const cn_finder *f, const char *hay, size_t hay_len)
+{
+    if (!f || !hay)
+        return NULL;
+    if (f->len == 0)
+        return hay;
+    if (f->len > hay_len)
+        return NULL;
+
+    return f->find(f, (const unsigned char *)hay, hay_len);
+}
+
+int cn_finder_equals(const cn_finder *f, const char *hay, size_t hay_len)
+{
+    if (!f || !hay || hay_len != f->len)
+        return 0;
+    if (!f->icase)
+        return memcmp(hay, f->needle, hay_len) == 0;
+
+    const unsigned char *h = (const unsigned char *)hay;
+    for (size_t i = 0; i < hay_len; ++i)
+    {
+        if (fold(h[i]) != f->needle[i])
+            return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,338 @@
+/*
+ * src/tags.c
+ *
+ * Interned tag dictionary for exact tag filters (`list -g a,b,c`).
+ *
+ * - Every distinct normalized tag (cn_tag_next) gets a small integer id;
+ *   an open-addressing hash maps names to ids.
+ * - db.tag_ids holds each note's tag ids, sorted and unique, in the
+ *   metadata arena; per tag, a roaring-style bitmap (bitmap.c) holds the
+ *   ids of the notes carrying it.
+ * - A filter is the intersection of its tags' bitmaps, so its cost follows
+ *   the rarest tag instead of notes x tag bytes, and "go" no longer
+ *   matches "golang".
+ *
+ * The dictionary is built on the first tag query against a loaded (heap)
+ * database and then kept in step by notes_io.c (cn_tags_forget /
+ * cn_tags_index around every change), so in the long-lived `serve` daemon
+ * it is paid for once. One-shot read-only commands scan instead (scan.c).
+ * It is dropped with the database and when the metadata arena is
+ * compacted, and rebuilt lazily. An allocation failure while updating also
+ * just drops it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cheatnote.h"
+#include "tags.h"
+#include "arena.h"
+#include "bitmap.h"
+#include "idmap.h"
+
+#define TAGS_MIN_SLOTS 64
+
+static struct
+{
+    int built;
+    char **names;      /* by tag id */
+    cn_bitmap *notes;  /* by tag id: ids of the notes carrying it */
+    uint32_t count;
+    uint32_t cap;
+    uint32_t *slots;   /* hash of names: tag id + 1, 0 = empty */
+    size_t mask;
+} dict;
+
+size_t cn_tag_next(const char *s, size_t len, size_t *pos, char *out)
+{
+    size_t i = *pos;
+    while (i < len)
+    {
+        size_t start = i;
+        while (i < len && s[i] != ',')
+            ++i;
+        size_t end = i;
+        if (i < len)
+            ++i; /* past the comma */
+
+        while (start < end && (s[start] == ' ' || (s[start] >= '\t' && s[start] <= '\r')))
+            ++start;
+        while (end > start && (s[end - 1] == ' ' || (s[end - 1] >= '\t' && s[end - 1] <= '\r')))
+            --end;
+        if (end == start)
+            continue;
+
+        size_t n = end - start < MAX_TAGS_LEN - 1 ? end - start : MAX_TAGS_LEN - 1;
+        for (size_t k = 0; k < n; ++k)
+        {
+            char c = s[start + k];
+            out[k] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+        }
+        out[n] = '\0';
+        *pos = i;
+        return n;
+    }
+    *pos = len;
+    return 0;
+}
+
+static uint32_t hash_name(const char *name, size_t len)
+{
+    uint32_t h = 2166136261u; /* FNV-1a */
+    for (size_t i = 0; i < len; ++i)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+/* Hash cell for `name`: holding its id + 1, or empty (0) */
+static size_t find_cell(const char *name, size_t len)
+{
+    size_t i = hash_name(name, len) & dict.mask;
+    while (dict.slots[i] != 0)
+    {
+        const char *other = dict.names[dict.slots[i] - 1];
+        if (strncmp(other, name, len) == 0 && other[len] == '\0')
+            break;
+        i = (i + 1) & dict.mask;
+    }
+    return i;
+}
+
+/* Id of `name`, or UINT32_MAX if it is not a known tag */
+static uint32_t lookup(const char *name, size_t len)
+{
+    if (!dict.slots)
+        return UINT32_MAX;
+    uint32_t cell = dict.slots[find_cell(name, len)];
+    return cell ? cell - 1 : UINT32_MAX;
+}
+
+/* Keep the hash at most half full */
+static int grow_slots(void)
+{
+    size_t want = TAGS_MIN_SLOTS;
+    while (want < ((size_t)dict.count + 1) * 2)
+        want *= 2;
+    if (dict.slots && want <= dict.mask + 1)
+        return 1;
+
+    uint32_t *slots = calloc(want, sizeof(*slots));
+    if (!slots)
+        return 0;
+    free(dict.slots);
+    dict.slots = slots;
+    dict.mask = want - 1;
+    for (uint32_t id = 0; id < dict.count; ++id)
+        dict.slots[find_cell(dict.names[id], strlen(dict.names[id]))] = id + 1;
+    return 1;
+}
+
+/* Id of `name`, interning it if new. Returns UINT32_MAX on allocation failure. */
+static uint32_t intern(const char *name, size_t len)
+{
+    uint32_t id = lookup(name, len);
+    if (id != UINT32_MAX)
+        return id;
+
+    if (dict.count == dict.cap)
+    {
+        uint32_t cap = dict.cap ? dict.cap * GROWTH_FACTOR : TAGS_MIN_SLOTS;
+        char **names = realloc(dict.names, cap * sizeof(*names));
+        if (!names)
+            return UINT32_MAX;
+        dict.names = names;
+        cn_bitmap *notes = realloc(dict.notes, cap * sizeof(*notes));
+        if (!notes)
+            return UINT32_MAX;
+        dict.notes = notes;
+        dict.cap = cap;
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy)
+        return UINT32_MAX;
+    memcpy(copy, name, len + 1);
+    dict.names[dict.count] = copy;
+    memset(&dict.notes[dict.count], 0, sizeof(*dict.notes));
+    dict.count++;
+    if (!grow_slots())
+    {
+        free(copy);
+        dict.count--;
+        return UINT32_MAX;
+    }
+    dict.slots[find_cell(name, len)] = dict.count;
+    return dict.count - 1;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Index the note at `slot`, whose id list must not hold arena data (new,
+ * forgotten or reset); returns 0 on allocation failure */
+static int index_slot(size_t slot)
+{
+    uint32_t ids[MAX_TAGS_LEN / 2 + 1];
+    size_t n = 0, pos = 0, len;
+    char name[MAX_TAGS_LEN];
+    const cn_text *tags = &db.tags[slot];
+
+    /* empty until stored, so a failure leaves nothing for cn_tags_clear */
+    db.tag_ids[slot].ids = NULL;
+    db.tag_ids[slot].count = 0;
+
+    while ((len = cn_tag_next(tags->str, tags->len, &pos, name)) > 0)
+    {
+        uint32_t id = intern(name, len);
+        if (id == UINT32_MAX || !cn_bitmap_add(&dict.notes[id], db.ids[slot]))
+            return 0;
+        ids[n++] = id;
+    }
+
+    /* Sorted and unique: "a,b,a" is {a, b} */
+    qsort(ids, n, sizeof(*ids), cmp_u32);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (unique == 0 || ids[unique - 1] != ids[i])
+            ids[unique++] = ids[i];
+    }
+
+    if (unique > 0)
+    {
+        const uint32_t *stored = cn_arena_store_u32(&db.meta_text, ids, unique);
+        if (!stored)
+            return 0;
+        db.tag_ids[slot].ids = stored;
+        db.tag_ids[slot].count = unique;
+    }
+    return 1;
+}
+
+int cn_tags_build(void)
+{
+    if (dict.built)
+        return 1;
+    cn_tags_clear();
+    dict.built = 1; /* so a failure below clears it again */
+
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        db.tag_ids[i].ids = NULL;
+        db.tag_ids[i].count = 0;
+    }
+    for (size_t i = 0; i < db.count; ++i)
+    {
+        if (!index_slot(i))
+        {
+            cn_tags_clear();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void cn_tags_clear(void)
+{
+    /* Hand the notes' id lists back to the metadata arena, so its live
+     * count (and the compaction heuristic) stays exact */
+    if (dict.built && db.tag_ids)
+    {
+        for (size_t i = 0; i < db.count; ++i)
+        {
+            cn_tag_list *list = &db.tag_ids[i];
+            if (list->count > 0)
+                cn_arena_release(&db.meta_text, list->count * sizeof(*list->ids));
+            list->ids = NULL;
+            list->count = 0;
+        }
+    }
+    for (uint32_t id = 0; id < dict.count; ++id)
+    {
+        free(dict.names[id]);
+        cn_bitmap_free(&dict.notes[id]);
+    }
+    free(dict.names);
+    free(dict.notes);
+    free(dict.slots);
+    memset(&dict, 0, sizeof(dict));
+}
+
+void cn_tags_forget(size_t slot)
+{
+    if (!dict.built)
+        return;
+
+    cn_tag_list *list = &db.tag_ids[slot];
+    for (size_t i = 0; i < list->count; ++i)
+        cn_bitmap_remove(&dict.notes[list->ids[i]], db.ids[slot]);
+    if (list->count > 0)
+        cn_arena_release(&db.meta_text, list->count * sizeof(*list->ids));
+    list->ids = NULL;
+    list->count = 0;
+}
+
+void cn_tags_index(size_t slot)
+{
+    if (dict.built && !index_slot(slot))
+        cn_tags_clear(); /* rebuilt by the next query */
+}
+
+typedef struct
+{
+    unsigned char *hits;
+    long found;
+} select_ctx;
+
+static void mark_hit(uint32_t id, void *arg)
+{
+    select_ctx *ctx = arg;
+    size_t slot = cn_idmap_find(id);
+    if (slot != SIZE_MAX)
+    {
+        ctx->hits[slot] = 1;
+        ctx->found++;
+    }
+}
+
+long cn_tags_select(const char *filter, unsigned char *hits)
+{
+    if (!cn_tags_build())
+        return -1;
+    memset(hits, 0, db.count);
+
+    size_t flen = strlen(filter);
+    const cn_bitmap **maps = malloc((flen / 2 + 1) * sizeof(*maps));
+    if (!maps)
+        return -1;
+
+    size_t n = 0, pos = 0, len;
+    char name[MAX_TAGS_LEN];
+    while ((len = cn_tag_next(filter, flen, &pos, name)) > 0)
+    {
+        uint32_t id = lookup(name, len);
+        if (id == UINT32_MAX)
+        {
+            free(maps);
+            return 0; /* no note has this tag */
+        }
+        maps[n++] = &dict.notes[id];
+    }
+
+    select_ctx ctx = {hits, 0};
+    if (n == 0)
+    {
+        /* Only separators: no filter, every note matches */
+        memset(hits, 1, db.count);
+        ctx.found = (long)db.count;
+    }
+    else
+    {
+        cn_bitmap_intersect(maps, n, mark_hit, &ctx);
+    }
+    free(maps);
+    return ctx.found;
+}
@@ -7,8 +7,10 @@ TESTDIR="./tests"
 DB="$TESTDIR/cheatnote_test.db"
 EXPORT="$TESTDIR/export.csv"
 IMPORT="$TESTDIR/import.csv"
+EXPORT_JSONL="$TESTDIR/export.jsonl"
+EXPORT_BIN="$TESTDIR/export.cnb"
 mkdir -p "$TESTDIR"
-rm -f "$DB" "$EXPORT" "$IMPORT"
+rm -f "$DB" "$DB.wal" "$DB.idx" "$DB.lock" "$DB.sock" "$EXPORT" "$IMPORT" "$EXPORT_JSONL" "$EXPORT_BIN"
 
 # Helper
 run() {
@@ -43,6 +45,12 @@ run $BIN list -n
 run $BIN list -s "content" -g "tag2,tag3" -i -c
 run $BIN list -s "^Line" -r -m
 run $BIN list -s "[A-Z][a-z]+ Note" -r
+$BIN list -s "\\<Line[[:digit:]]{1,2}\\>" -r -c | grep -q "Line1" || { echo "FAIL: regex bounds/word anchors"; exit 1; }
+run $BIN list -s "^(a|aa)*c$" -r -c
+# a group holding only an anchor may be repeated (a bare anchor may not)
+for re in "(^)*Line1" "(\\b)*Line1" "(^){1,2}Line1"; do
+    $BIN list -s "$re" -r -c | grep -q "Line1" || { echo "FAIL: regex $re"; exit 1; }
+done
 run $BIN list -s "!@#" -g "specialchars"
 run $BIN list -s "мир" -g "unicode" -i
 
@@ -74,10 +82,23 @@ cat "$EXPORT"
 cp "$EXPORT" "$IMPORT"
 run $BIN import "$IMPORT"
 run $BIN import -m "$IMPORT"
+run $BIN export "$EXPORT_JSONL"
+cat "$EXPORT_JSONL"
+run $BIN import -m "$EXPORT_JSONL"
+cp "$EXPORT_JSONL" "$IMPORT"
+run $BIN import "$IMPORT"
+run $BIN export "$EXPORT_JSONL"
+cmp "$IMPORT" "$EXPORT_JSONL" || { echo "FAIL: JSONL round trip changed ids or timestamps"; exit 1; }
+run $BIN export -z "$EXPORT_BIN"
+run $BIN import "$EXPORT_BIN"
+run $BIN list -c
 echo "" > "$IMPORT"
 run $BIN import "$IMPORT" || echo "Expected: import empty file error"
 echo 'corrupt,data,not,valid' > "$IMPORT"
 run $BIN import "$IMPORT" || echo "Expected: import corrupt file error"
+printf '1,"unterminated,content\n2,Resynced Row,kept after stray quote,resync' > "$IMPORT"
+run $BIN import -m "$IMPORT"
+run $BIN list -g "resync" -c | grep -q "Resynced Row" || { echo "FAIL: row after stray quote lost"; exit 1; }
 
 # 7. Stats, help, version, after modifications
 run $BIN stats
@@ -111,6 +132,100 @@ for i in {1..5}; do $BIN add "Parallel $i" "Content $i" "p$i" & done
 wait
 run $BIN list -g "p1,p2,p3,p4,p5"
 
-# 11. Clean up
-rm -f "$DB" "$EXPORT" "$IMPORT"
+# 10a. Batch: many commands, one save; failing lines are reported and skipped
+echo -e "\n# Batch test"
+printf '%s\n' '# comment' 'add "Batch One" "first\nsecond" batch' "add 'Batch Two' two batch" \
+    'edit 9999 "bad" "bad"' 'list -g batch -c' > "$IMPORT"
+! CHEATNOTE_DB="$DB" $BIN --no-daemon batch "$IMPORT" && echo "Expected: one batch line failed"
+CHEATNOTE_DB="$DB" run $BIN --no-daemon list -g "batch" -c
+
+# 10b. Concurrent edits of different fields of one note both survive: a
+# shared lock held meanwhile makes both editors load before either commits
+if command -v flock >/dev/null 2>&1; then
+    echo -e "\n# Concurrent edit merge test"
+    MERGE_ID=$(CHEATNOTE_DB="$DB" $BIN --no-daemon add "Merge Title" "Merge content" "merge" | grep -o '[0-9]*$')
+    flock -s "$DB.lock" sleep 1 &
+    sleep 0.2
+    CHEATNOTE_DB="$DB" $BIN --no-daemon edit -c "Merged content" "$MERGE_ID" &
+    CHEATNOTE_DB="$DB" $BIN --no-daemon edit -t "Merged Title" "$MERGE_ID" &
+    wait
+    MERGED=$(CHEATNOTE_DB="$DB" $BIN --no-daemon list -g "merge" -c)
+    echo "$MERGED"
+    [[ "$MERGED" == *"Merged Title"* && "$MERGED" == *"Merged content"* ]] ||
+        { echo "FAIL: concurrent edit lost a field"; exit 1; }
+fi
+
+# 10c. Tags match whole, case-insensitively: both the read-only scan and the
+# tag dictionary (built by a batch) skip "golang" for -g go
+echo -e "\n# Exact tag test"
+CHEATNOTE_DB="$DB" $BIN --no-daemon add "Tag Go" "Go content" " GO , exacttag" >/dev/null
+CHEATNOTE_DB="$DB" $BIN --no-daemon add "Tag Golang" "Golang content" "golang,exacttag" >/dev/null
+TAGGED=$(CHEATNOTE_DB="$DB" $BIN --no-daemon list -g "go,exacttag" -c)
+echo "$TAGGED"
+[[ "$TAGGED" == *"Tag Go"* && "$TAGGED" != *"Tag Golang"* ]] || { echo "FAIL: -g go matched a longer tag"; exit 1; }
+printf '%s\n' 'list -g Go -c' > "$IMPORT"
+TAGGED=$(CHEATNOTE_DB="$DB" $BIN --no-daemon batch "$IMPORT")
+echo "$TAGGED"
+[[ "$TAGGED" == *"Tag Go"* && "$TAGGED" != *"Tag Golang"* ]] || { echo "FAIL: tag dictionary matched a longer tag"; exit 1; }
+
+# 10d. The search index belongs to one database: a new database at the same
+# generation must not be answered from the deleted one's leftover .idx
+echo -e "\n# Stale index test"
+IDX_DB="$TESTDIR/cheatnote_idx.db"
+rm -f "$IDX_DB" "$IDX_DB.wal" "$IDX_DB.idx" "$IDX_DB.lock"
+printf '1,First Base,alphaword content,idx\n' > "$IMPORT"
+CHEATNOTE_DB="$IDX_DB" $BIN --no-daemon import "$IMPORT" >/dev/null
+CHEATNOTE_DB="$IDX_DB" run $BIN --no-daemon list -s "alphaword" -c
+rm -f "$IDX_DB" "$IDX_DB.wal"
+printf '1,Second Base,betaword content,idx\n' > "$IMPORT"
+CHEATNOTE_DB="$IDX_DB" $BIN --no-daemon import "$IMPORT" >/dev/null
+CHEATNOTE_DB="$IDX_DB" $BIN --no-daemon list -s "betaword" -c | grep -q "Second Base" ||
+    { echo "FAIL: search answered from another database's index"; exit 1; }
+# damaged bucket offsets (past the 64-byte header) mark the index stale
+head -c 4096 < /dev/zero | tr '\0' '\177' | dd of="$IDX_DB.idx" bs=1 seek=64 conv=notrunc 2>/dev/null
+CHEATNOTE_DB="$IDX_DB" $BIN --no-daemon list -s "betaword" -c | grep -q "Second Base" ||
+    { echo "FAIL: search trusted corrupt index offsets"; exit 1; }
+rm -f "$IDX_DB" "$IDX_DB.wal" "$IDX_DB.idx" "$IDX_DB.lock"
+
+# 11. Daemon: commands forwarded to `serve` and run locally agree
+echo -e "\n# Daemon test"
+CHEATNOTE_DB="$DB" $BIN serve &
+SERVE_PID=$!
+for _ in {1..50}; do [ -S "$DB.sock" ] && break; sleep 0.1; done
+CHEATNOTE_DB="$DB" run $BIN add "Daemon Note" "Served content" "daemon"
+CHEATNOTE_DB="$DB" run $BIN --no-daemon add "Local Note" "Local content" "daemon"
+CHEATNOTE_DB="$DB" run $BIN list -g "daemon" -c
+! CHEATNOTE_DB="$DB" $BIN edit 9999 "bad" "bad" && echo "Expected error"
+kill "$SERVE_PID"
+wait "$SERVE_PID"
+CHEATNOTE_DB="$DB" run $BIN list -g "daemon" -c
+
+# 11a. A served batch rewrites the base file under the exclusive lock: a
+# shared lock held meanwhile stalls it, then a local add queues for the same
+# lock just before release (so it retries sooner and usually commits first);
+# the add must survive, i.e. the daemon refreshes only once it holds the lock
+if command -v flock >/dev/null 2>&1; then
+    echo -e "\n# Daemon rewrite race test"
+    CHEATNOTE_DB="$DB" $BIN serve 2>/dev/null &
+    SERVE_PID=$!
+    for _ in {1..50}; do [ -S "$DB.sock" ] && break; sleep 0.1; done
+    for i in {1..4}; do
+        flock -s "$DB.lock" sleep 0.5 &
+        GUARD_PID=$!
+        sleep 0.1
+        printf 'add "Race Served %s" race race\n' "$i" | CHEATNOTE_DB="$DB" $BIN batch - >/dev/null &
+        SERVED_PID=$!
+        sleep 0.35
+        CHEATNOTE_DB="$DB" $BIN --no-daemon add "Race Local $i" "race" "race" >/dev/null &
+        wait "$GUARD_PID" "$SERVED_PID" $!
+    done
+    kill "$SERVE_PID"
+    wait "$SERVE_PID"
+    RACED=$(CHEATNOTE_DB="$DB" $BIN --no-daemon list -g "race" -c | grep -c "Race ")
+    echo "Race notes: $RACED"
+    [ "$RACED" -eq 8 ] || { echo "FAIL: served batch lost a concurrent commit"; exit 1; }
+fi
+
+# 12. Clean up
+rm -f "$DB" "$DB.wal" "$DB.idx" "$DB.lock" "$DB.sock" "$EXPORT" "$IMPORT" "$EXPORT_JSONL" "$EXPORT_BIN"
 echo -e "\nAll tests completed successfully."
\ No newline at end of file